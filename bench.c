@@ -0,0 +1,194 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+
+#include "bench.h"
+#include "glstate.h"
+#include "texpool.h"
+
+static int frames;
+static gboolean json;
+
+static GOptionEntry bench_entries[] = {
+	{ "frames", 'n', 0, G_OPTION_ARG_INT, &frames, "Timed frames per measurement", "N" },
+	{ "json", 'j', 0, G_OPTION_ARG_NONE, &json, "Print JSON instead of CSV", NULL },
+	{ NULL }
+};
+
+static struct {
+	GString *header, *values;
+	int fields, rows;
+} row;
+
+gboolean
+bench_parse_args(int *argc, char ***argv, const GOptionEntry *entries, int default_frames)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	gboolean ret;
+
+	frames = default_frames;
+	context = g_option_context_new(NULL);
+	if (entries)
+		g_option_context_add_main_entries(context, entries, NULL);
+	g_option_context_add_main_entries(context, bench_entries, NULL);
+	ret = g_option_context_parse(context, argc, argv, &error);
+	g_option_context_free(context);
+
+	if (!ret) {
+		fprintf(stderr, "Error: %s\n", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	if (frames <= 0) {
+		fprintf(stderr, "Error: bad frame count %d\n", frames);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int
+bench_frames(void)
+{
+	return frames;
+}
+
+gboolean
+bench_in_list(const char *list, const char *name)
+{
+	size_t len = strlen(name), n;
+
+	if (!list)
+		return TRUE;
+	for (;;) {
+		n = strcspn(list, ",");
+		if (n == len && !strncmp(list, name, len))
+			return TRUE;
+		if (!list[n])
+			return FALSE;
+		list += n + 1;
+	}
+}
+
+double
+bench_time(bench_frame_fn frame, gpointer data)
+{
+	gboolean gl = eglGetCurrentContext() != EGL_NO_CONTEXT;
+	gint64 start = 0;
+	int n;
+
+	for (n = 0; n < BENCH_WARMUP + frames; n++) {
+		if (n == BENCH_WARMUP) {
+			if (gl)
+				glFinish();
+			start = g_get_monotonic_time();
+		}
+		frame(data, n);
+		if (gl)
+			glFlush();
+	}
+	if (gl)
+		glFinish();
+
+	return (g_get_monotonic_time() - start) / 1000.0 / frames;
+}
+
+GLuint
+bench_target_get(int width, int height)
+{
+	GLuint target;
+
+	gl_state_active_texture(GL_TEXTURE0 + BENCH_TARGET_UNIT);
+	target = tex_pool_get(GL_TEXTURE_2D, GL_RGBA8, width, height, 1, 1);
+	gl_state_active_texture(GL_TEXTURE0);
+	gl_state_bind_framebuffer(tex_pool_framebuffer(target));
+	gl_state_viewport(0, 0, width, height);
+
+	return target;
+}
+
+void
+bench_target_put(GLuint target)
+{
+	gl_state_bind_framebuffer(0);
+	tex_pool_put(target);
+}
+
+void
+bench_row_begin(void)
+{
+	if (!row.header) {
+		row.header = g_string_new(NULL);
+		row.values = g_string_new(NULL);
+	}
+	g_string_truncate(row.header, 0);
+	g_string_truncate(row.values, 0);
+	row.fields = 0;
+}
+
+/* value is already JSON: a number, or a quoted string. */
+static void
+add_field(const char *name, const char *value)
+{
+	if (json) {
+		if (value)
+			g_string_append_printf(row.values, "%s\"%s\": %s",
+					       row.values->len ? ", " : "", name, value);
+	} else {
+		g_string_append_printf(row.header, "%s%s", row.fields ? "," : "", name);
+		g_string_append_printf(row.values, "%s%s", row.fields ? "," : "", value ? value : "");
+	}
+	row.fields++;
+}
+
+void
+bench_field(const char *name, const char *format, ...)
+{
+	va_list args;
+	char *value;
+
+	va_start(args, format);
+	value = g_strdup_vprintf(format, args);
+	va_end(args);
+	add_field(name, value);
+	g_free(value);
+}
+
+void
+bench_field_str(const char *name, const char *value)
+{
+	char *quoted = json ? g_strdup_printf("\"%s\"", value) : NULL;
+
+	add_field(name, quoted ? quoted : value);
+	g_free(quoted);
+}
+
+void
+bench_field_none(const char *name)
+{
+	add_field(name, NULL);
+}
+
+void
+bench_row_end(void)
+{
+	if (json)
+		printf("%s\n  { %s }", row.rows ? "," : "[", row.values->str);
+	else {
+		if (!row.rows)
+			printf("%s\n", row.header->str);
+		printf("%s\n", row.values->str);
+	}
+	row.rows++;
+	fflush(stdout);
+}
+
+void
+bench_finish(void)
+{
+	if (json)
+		printf(row.rows ? "\n]\n" : "[]\n");
+}
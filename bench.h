@@ -0,0 +1,56 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+/*
+ * What the benchmark programs share: the --frames and --json options,
+ * a warmed up timing loop, an offscreen RGBA8 target and the output,
+ * one CSV (or JSON) row per measurement.
+ */
+#define BENCH_WARMUP 10
+#define BENCH_TARGET_UNIT 4	/* clear of the units the benches sample */
+
+/*
+ * Parse the bench options in entries together with the common ones,
+ * --frames (frames by default) and --json.
+ */
+gboolean bench_parse_args(int *argc, char ***argv, const GOptionEntry *entries, int frames);
+/* Timed frames per measurement. */
+int bench_frames(void);
+/* Whether name is in the comma separated list; a NULL list holds every name. */
+gboolean bench_in_list(const char *list, const char *name);
+
+typedef void (*bench_frame_fn)(gpointer data, int n);
+
+/*
+ * Run frame BENCH_WARMUP times, then bench_frames() times, and return
+ * the milliseconds per timed frame. With a current GL context each
+ * frame is flushed and the clock runs from glFinish() to glFinish(), so
+ * the GPU work is in the time.
+ */
+double bench_time(bench_frame_fn frame, gpointer data);
+
+/*
+ * An RGBA8 width x height texture from the pool, allocated on unit
+ * BENCH_TARGET_UNIT and bound as the framebuffer, the viewport over it.
+ */
+GLuint bench_target_get(int width, int height);
+/* Rebind the default framebuffer and return target to the pool. */
+void bench_target_put(GLuint target);
+
+/*
+ * One row of named fields, in the same order every row: CSV with the
+ * header before the first row, or with --json an array of objects.
+ */
+void bench_row_begin(void);
+void bench_field(const char *name, const char *format, ...) G_GNUC_PRINTF(2, 3);
+void bench_field_str(const char *name, const char *value);
+/* A field this row has no value for: empty in CSV, left out of JSON. */
+void bench_field_none(const char *name);
+void bench_row_end(void);
+/* Close the JSON array after the last row. */
+void bench_finish(void);
+
+#endif
@@ -0,0 +1,246 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gdk/gdkx.h>
+#include <GLES3/gl3.h>
+
+#include "context.h"
+
+gboolean
+has_extension(const char *list, const char *name)
+{
+	size_t len = strlen(name);
+	const char *p = list;
+
+	while (p && (p = strstr(p, name))) {
+		if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+			return TRUE;
+		p += len;
+	}
+
+	return FALSE;
+}
+
+gboolean
+render_ctx_has_egl_ext(struct render_ctx *ctx, const char *name)
+{
+	return has_extension(eglQueryString(ctx->display, EGL_EXTENSIONS), name);
+}
+
+/* The legacy GL demo takes whatever compatibility context the driver has. */
+static const EGLint *
+context_attribs(enum render_api api)
+{
+	static const EGLint gles[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_NONE
+	};
+	static const EGLint gl_core[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	switch (api) {
+	case RENDER_API_GLES:
+		return gles;
+	case RENDER_API_GL_CORE:
+		return gl_core;
+	default:
+		return NULL;
+	}
+}
+
+static void
+print_setup(struct render_ctx *ctx, FILE *out)
+{
+        fprintf(out, "using GL setup: \n"
+                "   renderer '%s'\n"
+                "   vendor '%s'\n"
+                "   GL version '%s'\n"
+                "   GLSL version '%s'\n"
+                "   swap with damage %s, buffer age %s\n",
+                glGetString(GL_RENDERER), glGetString(GL_VENDOR),
+                glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION),
+                ctx->swap_buffers_with_damage ? "yes" : "no",
+                ctx->has_buffer_age ? "yes" : "no");
+}
+
+void
+render_ctx_init(struct render_ctx *ctx, GtkWidget *widget, enum render_api api)
+{
+	EGLint attributes[] = {
+		EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+		EGL_RED_SIZE, 1,
+		EGL_GREEN_SIZE, 1,
+		EGL_BLUE_SIZE, 1,
+		EGL_ALPHA_SIZE, 1,
+		EGL_RENDERABLE_TYPE, api == RENDER_API_GLES ? EGL_OPENGL_ES2_BIT : EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+
+	EGLint major, minor, n_config;
+	EGLBoolean ret;
+
+	ctx->api = api;
+	ctx->display = eglGetDisplay((EGLNativeDisplayType) gdk_x11_display_get_xdisplay (gtk_widget_get_display (widget)));
+
+	ret = eglInitialize(ctx->display, &major, &minor);
+	assert(ret == EGL_TRUE);
+
+	ret = eglBindAPI(api == RENDER_API_GLES ? EGL_OPENGL_ES_API : EGL_OPENGL_API);
+	assert(ret == EGL_TRUE);
+
+	eglChooseConfig(ctx->display, attributes, &ctx->config, 1, &n_config);
+	ctx->surface = eglCreateWindowSurface(ctx->display, ctx->config, gdk_x11_window_get_xid (gtk_widget_get_window (widget)), NULL);
+	assert(ctx->surface);
+
+	ctx->context = eglCreateContext(ctx->display, ctx->config, EGL_NO_CONTEXT,
+					context_attribs(api));
+	assert(ctx->context);
+
+	ret = eglMakeCurrent(ctx->display, ctx->surface, ctx->surface, ctx->context);
+	assert(ret == EGL_TRUE);
+
+	if (render_ctx_has_egl_ext(ctx, "EGL_KHR_swap_buffers_with_damage"))
+		ctx->swap_buffers_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)
+			eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+	else if (render_ctx_has_egl_ext(ctx, "EGL_EXT_swap_buffers_with_damage"))
+		ctx->swap_buffers_with_damage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)
+			eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+	ctx->has_buffer_age = render_ctx_has_egl_ext(ctx, "EGL_EXT_buffer_age");
+
+	print_setup(ctx, stdout);
+}
+
+/*
+ * Headless: the surfaceless platform where Mesa has it, the default
+ * display otherwise, with a tiny pbuffer or no surface at all.
+ */
+gboolean
+render_ctx_init_offscreen(struct render_ctx *ctx, enum render_api api)
+{
+	static const EGLint pbuffer_attribs[] = {
+		EGL_WIDTH, 16,
+		EGL_HEIGHT, 16,
+		EGL_NONE
+	};
+	EGLint attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, api == RENDER_API_GLES ? EGL_OPENGL_ES2_BIT : EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	const char *client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	EGLint n_config = 0;
+
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->api = api;
+	if (client && has_extension(client, "EGL_MESA_platform_surfaceless")) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+		ctx->display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+						    EGL_DEFAULT_DISPLAY, NULL);
+	} else {
+		ctx->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if (ctx->display == EGL_NO_DISPLAY || !eglInitialize(ctx->display, NULL, NULL)) {
+		fprintf(stderr, "Error: no EGL display\n");
+		return FALSE;
+	}
+	eglBindAPI(api == RENDER_API_GLES ? EGL_OPENGL_ES_API : EGL_OPENGL_API);
+
+	if (!eglChooseConfig(ctx->display, attributes, &ctx->config, 1, &n_config) || !n_config) {
+		if (!render_ctx_has_egl_ext(ctx, "EGL_KHR_surfaceless_context")) {
+			fprintf(stderr, "Error: no pbuffer config and no surfaceless contexts\n");
+			return FALSE;
+		}
+		attributes[1] = 0;
+		eglChooseConfig(ctx->display, attributes, &ctx->config, 1, &n_config);
+	}
+
+	ctx->surface = EGL_NO_SURFACE;
+	if (n_config)
+		ctx->surface = eglCreatePbufferSurface(ctx->display, ctx->config, pbuffer_attribs);
+
+	ctx->context = eglCreateContext(ctx->display, n_config ? ctx->config : EGL_NO_CONFIG_KHR,
+					EGL_NO_CONTEXT,
+					context_attribs(api));
+	if (!ctx->context ||
+	    !eglMakeCurrent(ctx->display, ctx->surface, ctx->surface, ctx->context)) {
+		fprintf(stderr, "Error: cannot create an offscreen context (0x%x)\n", eglGetError());
+		return FALSE;
+	}
+
+	/* Keep stdout for the results. */
+	print_setup(ctx, stderr);
+
+	return TRUE;
+}
+
+void
+render_ctx_swap(struct render_ctx *ctx)
+{
+	eglSwapBuffers(ctx->display, ctx->surface);
+}
+
+static const char *const present_names[] = {
+	[PRESENT_VSYNC] = "vsync",
+	[PRESENT_IMMEDIATE] = "immediate",
+	[PRESENT_ADAPTIVE] = "adaptive",
+	[PRESENT_FIXED] = "fixed",
+};
+
+gboolean
+present_mode_from_name(const char *name, enum present_mode *mode)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(present_names); i++) {
+		if (!strcmp(name, present_names[i])) {
+			*mode = i;
+			return TRUE;
+		}
+	}
+	fprintf(stderr, "Error: unknown present mode '%s', try vsync, immediate, adaptive or fixed\n",
+		name);
+	return FALSE;
+}
+
+const char *
+present_mode_name(enum present_mode mode)
+{
+	return present_names[mode];
+}
+
+enum present_mode
+present_mode_apply(enum present_mode mode)
+{
+	EGLDisplay display = eglGetCurrentDisplay();
+	EGLint interval = 1;
+
+	switch (mode) {
+	case PRESENT_VSYNC:
+		break;
+	case PRESENT_IMMEDIATE:
+	case PRESENT_FIXED:
+		interval = 0;
+		break;
+	case PRESENT_ADAPTIVE:
+		/* Without the extension a negative interval is clamped to 0. */
+		if (has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_EXT_swap_control_tear")) {
+			interval = -1;
+			break;
+		}
+		fprintf(stderr, "Warning: no EGL_EXT_swap_control_tear, adaptive falls back to vsync\n");
+		mode = PRESENT_VSYNC;
+		break;
+	}
+	if (!eglSwapInterval(display, interval))
+		fprintf(stderr, "Warning: swap interval %d refused, error 0x%x\n", interval,
+			eglGetError());
+
+	return mode;
+}
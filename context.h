@@ -0,0 +1,58 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <gtk/gtk.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+enum render_api {
+	RENDER_API_GLES,	/* OpenGL ES 3 */
+	RENDER_API_GL,		/* desktop OpenGL, compatibility profile */
+	RENDER_API_GL_CORE,	/* desktop OpenGL 3.3, core profile */
+};
+
+/*
+ * How swaps meet the display: wait for vblank, swap at once and tear,
+ * wait unless already late (then tear rather than lose a whole
+ * refresh), or swap at once with the frame loop pacing the frames.
+ */
+enum present_mode {
+	PRESENT_VSYNC,
+	PRESENT_IMMEDIATE,
+	PRESENT_ADAPTIVE,
+	PRESENT_FIXED,
+};
+
+/*
+ * EGL window surface and context on top of a realized GTK X11 widget,
+ * plus the EGL features the demos care about.
+ */
+struct render_ctx {
+	EGLDisplay display;
+	EGLSurface surface;
+	EGLContext context;
+	EGLConfig config;
+	enum render_api api;
+
+	PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swap_buffers_with_damage;
+	gboolean has_buffer_age;
+};
+
+void render_ctx_init(struct render_ctx *ctx, GtkWidget *widget, enum render_api api);
+/* Context without a window, for benchmarks. Returns FALSE, with a message, on failure. */
+gboolean render_ctx_init_offscreen(struct render_ctx *ctx, enum render_api api);
+void render_ctx_swap(struct render_ctx *ctx);
+
+gboolean present_mode_from_name(const char *name, enum present_mode *mode);
+const char *present_mode_name(enum present_mode mode);
+/*
+ * Swap interval for mode on the current context's draw surface. Returns
+ * the mode in effect: adaptive is vsync without EGL_EXT_swap_control_tear.
+ */
+enum present_mode present_mode_apply(enum present_mode mode);
+
+/* Whole-token match in a space separated extension string. */
+gboolean has_extension(const char *list, const char *name);
+gboolean render_ctx_has_egl_ext(struct render_ctx *ctx, const char *name);
+
+#endif
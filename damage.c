@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "damage.h"
+
+/* 16 bytes maps to one SSE2 or NEON register. */
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+
+static int
+row_differs(const uint8_t *a, const uint8_t *b, int n)
+{
+	v16u8 acc = { 0 };
+	uint64_t r[2];
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		v16u8 va, vb;
+
+		memcpy(&va, &a[i], 16);
+		memcpy(&vb, &b[i], 16);
+		acc |= va ^ vb;
+	}
+	memcpy(r, &acc, 16);
+	if (r[0] | r[1])
+		return 1;
+
+	for (; i < n; i++)
+		if (a[i] != b[i])
+			return 1;
+	return 0;
+}
+
+static void
+mark(struct damage *d, int col, int row)
+{
+	uint8_t *f = &d->dirty[row * d->cols + col];
+
+	if (!*f) {
+		*f = 1;
+		d->ndirty++;
+	}
+}
+
+void
+damage_init(struct damage *d, int width, int height, int tile)
+{
+	d->width = width;
+	d->height = height;
+	d->tile = tile;
+	d->cols = (width + tile - 1) / tile;
+	d->rows = (height + tile - 1) / tile;
+	d->dirty = calloc(d->cols * d->rows, 1);
+	d->ndirty = 0;
+}
+
+void
+damage_fini(struct damage *d)
+{
+	free(d->dirty);
+	d->dirty = NULL;
+}
+
+void
+damage_clear(struct damage *d)
+{
+	memset(d->dirty, 0, d->cols * d->rows);
+	d->ndirty = 0;
+}
+
+void
+damage_all(struct damage *d)
+{
+	memset(d->dirty, 1, d->cols * d->rows);
+	d->ndirty = d->cols * d->rows;
+}
+
+void
+damage_add_rect(struct damage *d, int x, int y, int w, int h)
+{
+	int c0, c1, r0, r1, c, r;
+
+	if (x < 0) {
+		w += x;
+		x = 0;
+	}
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	if (w <= 0 || h <= 0 || x >= d->width || y >= d->height)
+		return;
+
+	c0 = x / d->tile;
+	r0 = y / d->tile;
+	c1 = (x + w - 1) / d->tile;
+	r1 = (y + h - 1) / d->tile;
+	if (c1 >= d->cols)
+		c1 = d->cols - 1;
+	if (r1 >= d->rows)
+		r1 = d->rows - 1;
+
+	for (r = r0; r <= r1; r++)
+		for (c = c0; c <= c1; c++)
+			mark(d, c, r);
+}
+
+void
+damage_diff_plane(struct damage *d, const uint8_t *cur, const uint8_t *prev,
+		  int stride, int width_bytes, int height,
+		  int tile_w, int tile_h)
+{
+	int c, r, y;
+
+	for (r = 0; r < d->rows; r++) {
+		int y0 = r * tile_h;
+		int y1 = y0 + tile_h < height ? y0 + tile_h : height;
+
+		for (c = 0; c < d->cols; c++) {
+			int x0 = c * tile_w;
+			int n = x0 + tile_w < width_bytes ? tile_w : width_bytes - x0;
+
+			if (d->dirty[r * d->cols + c] || n <= 0)
+				continue;
+
+			for (y = y0; y < y1; y++) {
+				size_t off = (size_t)y * stride + x0;
+
+				if (row_differs(&cur[off], &prev[off], n)) {
+					mark(d, c, r);
+					break;
+				}
+			}
+		}
+	}
+}
+
+int
+damage_runs(const struct damage *d, int *rects)
+{
+	int c, r, n = 0;
+
+	for (r = 0; r < d->rows; r++) {
+		for (c = 0; c < d->cols; c++) {
+			int c0 = c;
+
+			if (!damage_is_dirty(d, c, r))
+				continue;
+			while (c + 1 < d->cols && damage_is_dirty(d, c + 1, r))
+				c++;
+
+			rects[n * 4 + 0] = c0;
+			rects[n * 4 + 1] = r;
+			rects[n * 4 + 2] = c - c0 + 1;
+			rects[n * 4 + 3] = 1;
+			n++;
+		}
+	}
+
+	return n;
+}
+
+void
+damage_history_init(struct damage_history *h, const struct damage *d)
+{
+	int i;
+
+	h->n = 0;
+	h->head = 0;
+	for (i = 0; i < DAMAGE_HISTORY; i++)
+		h->frames[i] = calloc(d->cols * d->rows, 1);
+}
+
+void
+damage_history_fini(struct damage_history *h)
+{
+	int i;
+
+	for (i = 0; i < DAMAGE_HISTORY; i++) {
+		free(h->frames[i]);
+		h->frames[i] = NULL;
+	}
+}
+
+void
+damage_history_push(struct damage_history *h, const struct damage *d)
+{
+	h->head = (h->head + DAMAGE_HISTORY - 1) % DAMAGE_HISTORY;
+	memcpy(h->frames[h->head], d->dirty, d->cols * d->rows);
+	if (h->n < DAMAGE_HISTORY)
+		h->n++;
+}
+
+int
+damage_history_accumulate(const struct damage_history *h, struct damage *dst, int age)
+{
+	int i, t, size = dst->cols * dst->rows;
+
+	if (age <= 0 || age > h->n)
+		return 0;
+
+	damage_clear(dst);
+	for (i = 0; i < age; i++) {
+		const uint8_t *f = h->frames[(h->head + i) % DAMAGE_HISTORY];
+
+		for (t = 0; t < size; t++)
+			dst->dirty[t] |= f[t];
+	}
+	for (t = 0; t < size; t++)
+		dst->ndirty += dst->dirty[t];
+
+	return 1;
+}
@@ -0,0 +1,73 @@
+#ifndef DAMAGE_H
+#define DAMAGE_H
+
+#include <stdint.h>
+
+/*
+ * Dirty tile tracking for partial texture updates. The frame is split in
+ * tile x tile luma blocks; a tile is dirty when any plane changed inside
+ * it, either found by comparing against the previous frame or reported
+ * by the producer as a damage rect.
+ */
+struct damage {
+	int width, height;	/* luma size in pixels */
+	int tile;		/* tile size in luma pixels */
+	int cols, rows;
+	int ndirty;
+	uint8_t *dirty;		/* cols * rows flags */
+};
+
+void damage_init(struct damage *d, int width, int height, int tile);
+void damage_fini(struct damage *d);
+void damage_clear(struct damage *d);
+void damage_all(struct damage *d);
+
+/* Producer-supplied damage, in luma pixels. */
+void damage_add_rect(struct damage *d, int x, int y, int w, int h);
+
+/*
+ * Compare one plane of the current frame with the previous one and mark
+ * changed tiles. A tile spans tile_w bytes and tile_h rows of the plane,
+ * e.g. tile x tile for NV12 luma and tile x tile/2 for its chroma.
+ */
+void damage_diff_plane(struct damage *d, const uint8_t *cur, const uint8_t *prev,
+		       int stride, int width_bytes, int height,
+		       int tile_w, int tile_h);
+
+/*
+ * Split the dirty tiles into horizontal runs, stored as x, y, w, h in
+ * tiles. rects must hold 4 * cols * rows ints. Returns the run count.
+ */
+int damage_runs(const struct damage *d, int *rects);
+
+/*
+ * Damage of the most recently presented frames, newest first. With
+ * EGL_EXT_buffer_age a back buffer that is age frames old only needs
+ * the damage of the last age frames repainted.
+ */
+#define DAMAGE_HISTORY 4
+
+struct damage_history {
+	int n;			/* valid entries */
+	int head;
+	uint8_t *frames[DAMAGE_HISTORY];
+};
+
+void damage_history_init(struct damage_history *h, const struct damage *d);
+void damage_history_fini(struct damage_history *h);
+void damage_history_push(struct damage_history *h, const struct damage *d);
+
+/*
+ * Set dst to the union of the last age entries. Returns 0 when the
+ * buffer content is unknown (age 0 or older than the history), and the
+ * caller has to repaint everything.
+ */
+int damage_history_accumulate(const struct damage_history *h, struct damage *dst, int age);
+
+static inline int
+damage_is_dirty(const struct damage *d, int col, int row)
+{
+	return d->dirty[row * d->cols + col];
+}
+
+#endif
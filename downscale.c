@@ -0,0 +1,118 @@
+#include <math.h>
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "downscale.h"
+#include "glstate.h"
+#include "program.h"
+#include "texpool.h"
+
+static const char *convert_frag_shader_text =
+	"#version 300 es				\n"
+	"precision mediump float;			\n"
+	"precision mediump sampler2DArray;		\n"
+	"						\n"
+	"in vec2 vTexCoord;				\n"
+	"						\n"
+	"uniform sampler2DArray uTexY;			\n"
+	"uniform sampler2DArray uTexUV;			\n"
+	"uniform float uLayer;				\n"
+	"						\n"
+	"out vec4 fragColor;				\n"
+	"						\n"
+	"void main() {					\n"
+	"  vec3 c = vec3(vTexCoord, uLayer);		\n"
+	"  float y = texture(uTexY, c).x;		\n"
+	"  vec2 uv = texture(uTexUV, c).xy - 0.5;	\n"
+	"  fragColor = vec4(y + 1.13983*uv.y,		\n"
+	"                   y - 0.39465*uv.x - 0.58060*uv.y,\n"
+	"                   y + 2.03211*uv.x, 1.0);	\n"
+	"}						\n";
+
+void
+mipchain_init(struct mipchain *m, int width, int height, int layers)
+{
+	m->width = width;
+	m->height = height;
+	m->layers = layers;
+	m->levels = 1 + (int)floor(log2(MAX(width, height)));
+
+	m->texture = tex_pool_get(GL_TEXTURE_2D_ARRAY, GL_RGBA8, width, height, layers, m->levels);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glGenFramebuffers(1, &m->fbo);
+	m->program = program_get(fullscreen_vert_shader(GL_FALSE), convert_frag_shader_text, NULL);
+	gl_state_use_program(m->program);
+	gl_state_uniform1i(glGetUniformLocation(m->program, "uTexY"), 0);
+	gl_state_uniform1i(glGetUniformLocation(m->program, "uTexUV"), 1);
+	m->ulayer = glGetUniformLocation(m->program, "uLayer");
+	glCheckError();
+}
+
+void
+mipchain_fini(struct mipchain *m)
+{
+	gl_state_forget_framebuffer(m->fbo);
+	glDeleteFramebuffers(1, &m->fbo);
+	tex_pool_put(m->texture);
+}
+
+void
+mipchain_convert_nv12(struct mipchain *m, GLuint tex_y, GLuint tex_uv)
+{
+	GLuint prev;
+	int i;
+
+	prev = gl_state_framebuffer();
+	gl_state_bind_framebuffer(m->fbo);
+	gl_state_viewport(0, 0, m->width, m->height);
+	gl_state_use_program(m->program);
+	gl_state_active_texture(GL_TEXTURE0);
+	gl_state_bind_texture(GL_TEXTURE_2D_ARRAY, tex_y);
+	gl_state_active_texture(GL_TEXTURE1);
+	gl_state_bind_texture(GL_TEXTURE_2D_ARRAY, tex_uv);
+
+	for (i = 0; i < m->layers; i++) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m->texture, 0, i);
+		gl_state_uniform1f(m->ulayer, i);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	gl_state_bind_framebuffer(prev);
+
+	gl_state_active_texture(GL_TEXTURE2);
+	gl_state_bind_texture(GL_TEXTURE_2D_ARRAY, m->texture);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	gl_state_active_texture(GL_TEXTURE0);
+	glCheckError();
+}
+
+float
+mipchain_lod(const struct mipchain *m, int tile_w, int tile_h)
+{
+	/* The larger ratio wins: blur the other axis rather than alias this one. */
+	float ratio = MAX((float)m->width / MAX(tile_w, 1), (float)m->height / MAX(tile_h, 1));
+
+	return CLAMP(log2f(ratio), 0.0f, m->levels - 1);
+}
+
+static size_t
+level_bytes(const struct mipchain *m, int level)
+{
+	return (size_t)MAX(m->width >> level, 1) * MAX(m->height >> level, 1) * 4;
+}
+
+void
+mipchain_footprint(const struct mipchain *m, float lod, size_t *mip, size_t *full)
+{
+	int level = floorf(lod);
+
+	*mip = level_bytes(m, level);
+	if (level + 1 < m->levels && lod > level)
+		*mip += level_bytes(m, level + 1);
+	/* Luma plus half size interleaved chroma. */
+	*full = (size_t)m->width * m->height + (size_t)((m->width + 1) / 2) * ((m->height + 1) / 2) * 2;
+}
@@ -0,0 +1,44 @@
+#ifndef DOWNSCALE_H
+#define DOWNSCALE_H
+
+#include <stddef.h>
+
+#include <GLES3/gl3.h>
+
+/*
+ * Downscale stage for walls of small tiles: NV12 array layers are
+ * converted once per content change into an RGBA8 array texture with a
+ * full mip chain, so each tile samples a level close to its own size
+ * instead of minifying the full resolution planes (which aliases and
+ * reads far more memory than the tile shows).
+ */
+struct mipchain {
+	GLuint texture;		/* RGBA8 2D array, levels mip levels */
+	int width, height, layers, levels;
+	GLuint fbo;
+	GLuint program;
+	GLint ulayer;
+};
+
+/* Need a current context. */
+void mipchain_init(struct mipchain *m, int width, int height, int layers);
+void mipchain_fini(struct mipchain *m);
+
+/*
+ * Convert the NV12 layers in the R8 and RG8 arrays tex_y and tex_uv into
+ * level 0, then rebuild the lower levels. The framebuffer binding is
+ * restored; the caller resets its viewport and program.
+ */
+void mipchain_convert_nv12(struct mipchain *m, GLuint tex_y, GLuint tex_uv);
+
+/* Level of detail to sample for tiles of tile_w x tile_h pixels. */
+float mipchain_lod(const struct mipchain *m, int tile_w, int tile_h);
+
+/*
+ * Rough texture bytes one tile reads per draw: the two levels trilinear
+ * filtering blends at lod, against the NV12 planes at full resolution,
+ * which a strongly minified tile touches nearly all of.
+ */
+void mipchain_footprint(const struct mipchain *m, float lod, size_t *mip, size_t *full);
+
+#endif
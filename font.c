@@ -0,0 +1,122 @@
+#include <string.h>
+
+#include "font.h"
+
+static const struct {
+	char c;
+	const char *rows[FONT_HEIGHT];
+} glyphs[] = {
+	{ '0', { ".###.", "#...#", "#..##", "#.#.#", "##..#", "#...#", ".###." } },
+	{ '1', { "..#..", ".##..", "..#..", "..#..", "..#..", "..#..", ".###." } },
+	{ '2', { ".###.", "#...#", "....#", "...#.", "..#..", ".#...", "#####" } },
+	{ '3', { "#####", "...#.", "..#..", "...#.", "....#", "#...#", ".###." } },
+	{ '4', { "...#.", "..##.", ".#.#.", "#..#.", "#####", "...#.", "...#." } },
+	{ '5', { "#####", "#....", "####.", "....#", "....#", "#...#", ".###." } },
+	{ '6', { "..##.", ".#...", "#....", "####.", "#...#", "#...#", ".###." } },
+	{ '7', { "#####", "....#", "...#.", "..#..", ".#...", ".#...", ".#..." } },
+	{ '8', { ".###.", "#...#", "#...#", ".###.", "#...#", "#...#", ".###." } },
+	{ '9', { ".###.", "#...#", "#...#", ".####", "....#", "...#.", ".##.." } },
+	{ 'A', { ".###.", "#...#", "#...#", "#####", "#...#", "#...#", "#...#" } },
+	{ 'B', { "####.", "#...#", "#...#", "####.", "#...#", "#...#", "####." } },
+	{ 'C', { ".###.", "#...#", "#....", "#....", "#....", "#...#", ".###." } },
+	{ 'D', { "###..", "#..#.", "#...#", "#...#", "#...#", "#..#.", "###.." } },
+	{ 'E', { "#####", "#....", "#....", "####.", "#....", "#....", "#####" } },
+	{ 'F', { "#####", "#....", "#....", "####.", "#....", "#....", "#...." } },
+	{ 'G', { ".###.", "#...#", "#....", "#.###", "#...#", "#...#", ".####" } },
+	{ 'H', { "#...#", "#...#", "#...#", "#####", "#...#", "#...#", "#...#" } },
+	{ 'I', { ".###.", "..#..", "..#..", "..#..", "..#..", "..#..", ".###." } },
+	{ 'J', { "..###", "...#.", "...#.", "...#.", "...#.", "#..#.", ".##.." } },
+	{ 'K', { "#...#", "#..#.", "#.#..", "##...", "#.#..", "#..#.", "#...#" } },
+	{ 'L', { "#....", "#....", "#....", "#....", "#....", "#....", "#####" } },
+	{ 'M', { "#...#", "##.##", "#.#.#", "#.#.#", "#...#", "#...#", "#...#" } },
+	{ 'N', { "#...#", "#...#", "##..#", "#.#.#", "#..##", "#...#", "#...#" } },
+	{ 'O', { ".###.", "#...#", "#...#", "#...#", "#...#", "#...#", ".###." } },
+	{ 'P', { "####.", "#...#", "#...#", "####.", "#....", "#....", "#...." } },
+	{ 'Q', { ".###.", "#...#", "#...#", "#...#", "#.#.#", "#..#.", ".##.#" } },
+	{ 'R', { "####.", "#...#", "#...#", "####.", "#.#..", "#..#.", "#...#" } },
+	{ 'S', { ".####", "#....", "#....", ".###.", "....#", "....#", "####." } },
+	{ 'T', { "#####", "..#..", "..#..", "..#..", "..#..", "..#..", "..#.." } },
+	{ 'U', { "#...#", "#...#", "#...#", "#...#", "#...#", "#...#", ".###." } },
+	{ 'V', { "#...#", "#...#", "#...#", "#...#", "#...#", ".#.#.", "..#.." } },
+	{ 'W', { "#...#", "#...#", "#...#", "#.#.#", "#.#.#", "#.#.#", ".#.#." } },
+	{ 'X', { "#...#", "#...#", ".#.#.", "..#..", ".#.#.", "#...#", "#...#" } },
+	{ 'Y', { "#...#", "#...#", ".#.#.", "..#..", "..#..", "..#..", "..#.." } },
+	{ 'Z', { "#####", "....#", "...#.", "..#..", ".#...", "#....", "#####" } },
+	{ '.', { ".....", ".....", ".....", ".....", ".....", ".##..", ".##.." } },
+	{ ',', { ".....", ".....", ".....", ".....", ".##..", "..#..", ".#..." } },
+	{ ':', { ".....", ".##..", ".##..", ".....", ".##..", ".##..", "....." } },
+	{ '-', { ".....", ".....", ".....", "#####", ".....", ".....", "....." } },
+	{ '+', { ".....", "..#..", "..#..", "#####", "..#..", "..#..", "....." } },
+	{ '/', { ".....", "....#", "...#.", "..#..", ".#...", "#....", "....." } },
+	{ '%', { "##...", "##..#", "...#.", "..#..", ".#...", "#..##", "...##" } },
+	{ '(', { "...#.", "..#..", ".#...", ".#...", ".#...", "..#..", "...#." } },
+	{ ')', { ".#...", "..#..", "...#.", "...#.", "...#.", "..#..", ".#..." } },
+	{ '_', { ".....", ".....", ".....", ".....", ".....", ".....", "#####" } },
+	{ '=', { ".....", ".....", "#####", ".....", "#####", ".....", "....." } },
+	{ '#', { ".#.#.", ".#.#.", "#####", ".#.#.", "#####", ".#.#.", ".#.#." } },
+	{ '|', { "..#..", "..#..", "..#..", "..#..", "..#..", "..#..", "..#.." } },
+};
+
+static uint8_t bits[128][FONT_HEIGHT];
+static int ready;
+
+static void
+build(void)
+{
+	unsigned int i;
+	int r, x;
+
+	for (i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); i++) {
+		uint8_t *g = bits[(int)glyphs[i].c];
+
+		for (r = 0; r < FONT_HEIGHT; r++)
+			for (x = 0; x < FONT_WIDTH; x++)
+				if (glyphs[i].rows[r][x] == '#')
+					g[r] |= 1 << (FONT_WIDTH - 1 - x);
+	}
+	ready = 1;
+}
+
+const uint8_t *
+font_glyph(int c)
+{
+	if (!ready)
+		build();
+	if (c >= 'a' && c <= 'z')
+		c -= 'a' - 'A';
+	if (c < 0 || c >= 128)
+		c = ' ';
+
+	return bits[c];
+}
+
+void
+font_atlas_cell(int c, int *x, int *y)
+{
+	if (c != FONT_ATLAS_SOLID && (c < ' ' || c >= 128))
+		c = ' ';
+	c -= ' ';
+	*x = c % FONT_ATLAS_COLS * FONT_CELL_WIDTH;
+	*y = c / FONT_ATLAS_COLS * FONT_CELL_HEIGHT;
+}
+
+void
+font_atlas(uint8_t *texels)
+{
+	int c, r, col, x, y;
+
+	memset(texels, 0, FONT_ATLAS_WIDTH * FONT_ATLAS_HEIGHT);
+	for (c = ' '; c < 128; c++) {
+		const uint8_t *g = font_glyph(c);
+
+		font_atlas_cell(c, &x, &y);
+		for (r = 0; r < FONT_HEIGHT; r++)
+			for (col = 0; col < FONT_WIDTH; col++)
+				if (g[r] & (1 << (FONT_WIDTH - 1 - col)))
+					texels[(y + r) * FONT_ATLAS_WIDTH + x + col] = 255;
+	}
+
+	font_atlas_cell(FONT_ATLAS_SOLID, &x, &y);
+	for (r = 0; r < FONT_CELL_HEIGHT; r++)
+		memset(&texels[(y + r) * FONT_ATLAS_WIDTH + x], 255, FONT_CELL_WIDTH);
+}
@@ -0,0 +1,34 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <stdint.h>
+
+/*
+ * Tiny 5x7 bitmap font: space, digits, upper case letters and some
+ * punctuation; lower case maps to upper case, anything else is blank.
+ */
+#define FONT_WIDTH 5
+#define FONT_HEIGHT 7
+
+/* FONT_HEIGHT rows of glyph c, bit FONT_WIDTH - 1 is the leftmost column. */
+const uint8_t *font_glyph(int c);
+
+/*
+ * Glyph atlas: ASCII 32 to 127 in cells of FONT_CELL_WIDTH x
+ * FONT_CELL_HEIGHT one byte coverage texels, FONT_ATLAS_COLS to a row,
+ * glyph at the top left of its cell with a blank column and row as
+ * gutter. One more cell after them is solid, for rectangles.
+ */
+#define FONT_CELL_WIDTH (FONT_WIDTH + 1)
+#define FONT_CELL_HEIGHT (FONT_HEIGHT + 1)
+#define FONT_ATLAS_COLS 16
+#define FONT_ATLAS_WIDTH (FONT_ATLAS_COLS * FONT_CELL_WIDTH)
+#define FONT_ATLAS_HEIGHT (7 * FONT_CELL_HEIGHT)
+#define FONT_ATLAS_SOLID 128
+
+/* Fill FONT_ATLAS_WIDTH x FONT_ATLAS_HEIGHT bytes, 255 where a glyph is set. */
+void font_atlas(uint8_t *texels);
+/* Top left texel of the cell of c, or of the solid cell for FONT_ATLAS_SOLID. */
+void font_atlas_cell(int c, int *x, int *y);
+
+#endif
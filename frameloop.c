@@ -0,0 +1,293 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "context.h"
+#include "frameloop.h"
+#include "loadstats.h"
+#include "texpool.h"
+
+static int stats_period;
+static gboolean continuous;
+static int fps;
+static int vram_budget;
+static char *present_name;
+static enum present_mode present_mode;
+static gboolean pacing;
+
+/* Fixed mode: the timeout wakes this early, the rest is slept to the deadline. */
+#define PACE_SLACK_MS 2
+/* Frame intervals kept for one report. */
+#define PACING_MAX 2048
+
+static gint64 period, deadline;	/* ns */
+static struct {
+	gint64 last, since;
+	gint64 intervals[PACING_MAX];
+	int n;
+	gint64 wake_sum, wake_max;	/* fixed mode: how late the ticks ran */
+	unsigned int wakes, missed;
+} pace;
+
+static GOptionEntry loop_entries[] = {
+	{ "stats", 0, 0, G_OPTION_ARG_INT, &stats_period, "Print CPU load and draw rate every N seconds", "N" },
+	{ "continuous", 0, 0, G_OPTION_ARG_NONE, &continuous, "Redraw on every tick even when nothing changed", NULL },
+	{ "fps", 0, 0, G_OPTION_ARG_INT, &fps, "Tick rate, overriding the demo default", "N" },
+	{ "vram-budget", 0, 0, G_OPTION_ARG_INT, &vram_budget, "Texture pool size before idle textures are evicted", "MIB" },
+	{ "present", 0, 0, G_OPTION_ARG_STRING, &present_name, "Present mode: vsync, immediate, adaptive or fixed (immediate swaps, ticks paced to --fps)", "MODE" },
+	{ "pacing", 0, 0, G_OPTION_ARG_NONE, &pacing, "Print frame pacing every second", NULL },
+	{ NULL }
+};
+
+gboolean
+frame_loop_parse_args(int *argc, char ***argv, const GOptionEntry *entries)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	gboolean ret;
+
+	context = g_option_context_new(NULL);
+	if (entries)
+		g_option_context_add_main_entries(context, entries, NULL);
+	g_option_context_add_main_entries(context, loop_entries, NULL);
+	g_option_context_add_group(context, gtk_get_option_group(TRUE));
+	ret = g_option_context_parse(context, argc, argv, &error);
+	g_option_context_free(context);
+
+	if (!ret) {
+		fprintf(stderr, "Error: %s\n", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	if (present_name && !present_mode_from_name(present_name, &present_mode))
+		return FALSE;
+	if (vram_budget > 0)
+		tex_pool_set_budget((size_t)vram_budget << 20);
+
+	gtk_init(argc, argv);
+
+	return TRUE;
+}
+
+static gint64
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * G_GINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+static void
+sleep_until(gint64 t)
+{
+	struct timespec ts = { t / 1000000000, t % 1000000000 };
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+/* Run the tick, TRUE when the window is to be drawn. */
+static gboolean
+tick(struct frame_loop *loop)
+{
+	gboolean new_frame = loop->tick ? loop->tick(loop->data) : FALSE;
+
+	return new_frame || continuous;
+}
+
+/*
+ * Vsync and adaptive: a tick is due at absolute deadlines period apart,
+ * give or take half a refresh, so a rate below the refresh rate is
+ * spread evenly over the vblanks. A frame is queued in the update phase
+ * and drawn in the paint phase of the same cycle.
+ */
+static gboolean
+clock_tick(GtkWidget *widget, GdkFrameClock *clock, gpointer data)
+{
+	struct frame_loop *loop = data;
+	gint64 frame_time = gdk_frame_clock_get_frame_time(clock);
+	gint64 now = frame_time * 1000, refresh, presented;
+
+	gdk_frame_clock_get_refresh_info(clock, frame_time, &refresh, &presented);
+	if (!deadline)
+		deadline = now;
+	if (now < deadline - refresh * 1000 / 2)
+		return G_SOURCE_CONTINUE;
+	while (deadline <= now + refresh * 1000 / 2)
+		deadline += period;
+
+	if (tick(loop))
+		gtk_widget_queue_draw(widget);
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* Draw now rather than on the next frame clock cycle, when it can be seen. */
+static void
+draw_now(struct frame_loop *loop)
+{
+	if (gtk_widget_is_drawable(loop->widget))
+		((gboolean (*)(GtkWidget *))loop->draw)(loop->widget);
+	else
+		gtk_widget_queue_draw(loop->widget);
+}
+
+static gboolean timed_tick(gpointer data);
+
+/* Fixed mode wakes early and sleeps the rest, immediate mode rounds up. */
+static void
+schedule_timed_tick(struct frame_loop *loop, gint64 now)
+{
+	if (present_mode == PRESENT_FIXED)
+		g_timeout_add_full(G_PRIORITY_HIGH, MAX((deadline - now) / 1000000 - PACE_SLACK_MS, 0),
+				   timed_tick, loop, NULL);
+	else
+		g_timeout_add_full(G_PRIORITY_DEFAULT, MAX((deadline - now + 999999) / 1000000, 0),
+				   timed_tick, loop, NULL);
+}
+
+/*
+ * Immediate and fixed: on an absolute deadline, so that timer latency
+ * does not add up; deadlines already passed are skipped, not caught up
+ * with. The draw, and with it the swap, runs in the tick.
+ */
+static gboolean
+timed_tick(gpointer data)
+{
+	struct frame_loop *loop = data;
+	gint64 now;
+
+	if (present_mode == PRESENT_FIXED) {
+		sleep_until(deadline);
+		now = now_ns();
+		pace.wake_sum += now - deadline;
+		pace.wake_max = MAX(pace.wake_max, now - deadline);
+		pace.wakes++;
+	}
+
+	if (tick(loop))
+		draw_now(loop);
+
+	now = now_ns();
+	for (deadline += period; deadline <= now; deadline += period)
+		pace.missed++;
+	schedule_timed_tick(loop, now);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* After the demo's realize handler, with its context current. */
+static void
+realized(GtkWidget *widget, gpointer data)
+{
+	(void)widget;
+	(void)data;
+	present_mode = present_mode_apply(present_mode);
+	if (present_mode == PRESENT_FIXED)
+		printf("present: fixed, %.2f fps\n", 1e9 / period);
+	else
+		printf("present: %s\n", present_mode_name(present_mode));
+}
+
+void
+frame_loop_run(struct frame_loop *loop, GCallback realize, GCallback draw)
+{
+	GtkWidget *w;
+
+	w = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_widget_set_double_buffered(GTK_WIDGET(w), FALSE);
+	g_signal_connect(G_OBJECT(w), "realize", realize, loop->data);
+	g_signal_connect_after(G_OBJECT(w), "realize", G_CALLBACK(realized), NULL);
+	g_signal_connect(G_OBJECT(w), "draw", draw, loop->data);
+	g_signal_connect(G_OBJECT(w), "destroy", G_CALLBACK(gtk_main_quit), NULL);
+	loop->widget = w;
+	loop->draw = draw;
+
+	if (fps > 0)
+		period = 1000000000 / fps;
+	else
+		period = (loop->interval ? loop->interval : 34) * G_GINT64_CONSTANT(1000000);
+	if ((loop->tick || continuous) &&
+	    (present_mode == PRESENT_VSYNC || present_mode == PRESENT_ADAPTIVE)) {
+		gtk_widget_add_tick_callback(w, clock_tick, loop, NULL);
+	} else if (loop->tick || continuous) {
+		deadline = now_ns() + period;
+		schedule_timed_tick(loop, deadline - period);
+	}
+	if (stats_period > 0)
+		loadstats_start(stats_period);
+
+	gtk_widget_show(w);
+
+	gtk_main();
+}
+
+static int
+compare_interval(const void *a, const void *b)
+{
+	gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Intervals between presented frames: a frame more than half as late
+ * again as the median one counts as late. Frames skipped because
+ * nothing changed show up as late too.
+ */
+static void
+print_pacing(gint64 now)
+{
+	gint64 *iv = pace.intervals;
+	double mean = 0, var = 0;
+	int i, n = pace.n, late = 0;
+
+	if (!n)
+		return;
+	qsort(iv, n, sizeof(*iv), compare_interval);
+	for (i = 0; i < n; i++)
+		mean += iv[i];
+	mean /= n;
+	for (i = 0; i < n; i++) {
+		var += (iv[i] - mean) * (iv[i] - mean);
+		late += iv[i] > iv[n / 2] * 3 / 2;
+	}
+
+	printf("pacing: %s, %.1f fps, interval median %.2f ms, p99 %.2f ms, max %.2f ms, "
+	       "%.2f ms jitter, %d late",
+	       present_mode_name(present_mode), n * 1e9 / (now - pace.since), iv[n / 2] / 1e6,
+	       iv[MIN(n * 99 / 100, n - 1)] / 1e6, iv[n - 1] / 1e6, sqrt(var / n) / 1e6, late);
+	if (present_mode == PRESENT_FIXED && pace.wakes)
+		printf(", ticks %.3f ms late on average, %.3f ms at worst, %u missed",
+		       pace.wake_sum / 1e6 / pace.wakes, pace.wake_max / 1e6, pace.missed);
+	printf("\n");
+
+	pace.n = 0;
+	pace.wake_sum = pace.wake_max = 0;
+	pace.wakes = pace.missed = 0;
+	pace.since = now;
+}
+
+void
+frame_loop_drawn(struct frame_loop *loop)
+{
+	gint64 now;
+
+	(void)loop;
+	loadstats_draw();
+	if (!pacing)
+		return;
+
+	now = now_ns();
+	if (pace.last && pace.n < PACING_MAX)
+		pace.intervals[pace.n++] = now - pace.last;
+	pace.last = now;
+	if (!pace.since)
+		pace.since = now;
+	else if (now - pace.since >= 1000000000)
+		print_pacing(now);
+}
@@ -0,0 +1,43 @@
+#ifndef FRAMELOOP_H
+#define FRAMELOOP_H
+
+#include <gtk/gtk.h>
+
+/*
+ * Frame loop driver. tick runs every interval ms (1 / --fps s) and
+ * returns TRUE when it produced a new frame; only then is the window
+ * drawn, unless --continuous is given. In the vsync and adaptive present
+ * modes ticks follow the frame clock and the frame is drawn in the same
+ * cycle; in the immediate and fixed modes a timer on absolute deadlines
+ * ticks and the draw callback runs right away, so the swap happens on
+ * the deadline. Expose and resize reach the draw callback through GTK on
+ * their own, so without a tick a still image costs nothing.
+ */
+typedef gboolean (*frame_tick_func)(gpointer data);
+
+struct frame_loop {
+	guint interval;
+	frame_tick_func tick;	/* NULL for a still image */
+	gpointer data;
+	GtkWidget *widget;
+	GCallback draw;		/* set by frame_loop_run() */
+};
+
+/*
+ * Parse the demo options in entries together with the common frame loop
+ * ones (--stats, --continuous, --fps, --vram-budget, --present, --pacing)
+ * and initialize GTK. The present mode is applied once the demo's
+ * realize handler has made its context current.
+ */
+gboolean frame_loop_parse_args(int *argc, char ***argv, const GOptionEntry *entries);
+
+/*
+ * Create the window, hook up realize and draw callbacks and run the main
+ * loop until the window goes away.
+ */
+void frame_loop_run(struct frame_loop *loop, GCallback realize, GCallback draw);
+
+/* Account for one presented frame. */
+void frame_loop_drawn(struct frame_loop *loop);
+
+#endif
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "framepool.h"
+
+/*
+ * Lives at the end of the alignment padding, right in front of the
+ * buffer, so it is found at the same offset whatever the alignment.
+ */
+struct frame_buf {
+	struct frame_pool *pool;
+	struct frame_buf *next;	/* free list */
+	gint refs;
+};
+
+struct frame_pool {
+	size_t size;
+	size_t align;
+	void (*init)(uint8_t *buf, void *data);
+	void *data;
+
+	GMutex lock;
+	struct frame_buf *free;
+	int allocated;
+	int in_use;
+	gboolean dead;
+
+	struct {
+		unsigned int hits, misses;
+		int high_water;	/* most buffers in use at once, ever */
+		gint64 since;
+	} stats;
+};
+
+static inline uint8_t *
+buf_data(struct frame_buf *b)
+{
+	return (uint8_t *)(b + 1);
+}
+
+static inline struct frame_buf *
+data_buf(const uint8_t *data)
+{
+	return (struct frame_buf *)data - 1;
+}
+
+static void
+buf_free(struct frame_buf *b)
+{
+	free(buf_data(b) - b->pool->align);
+}
+
+/* Called with the lock held; the pool grows by one buffer. */
+static struct frame_buf *
+alloc_buf(struct frame_pool *pool)
+{
+	void *mem;
+	struct frame_buf *b;
+
+	if (posix_memalign(&mem, pool->align, pool->align + pool->size)) {
+		fprintf(stderr, "Error: out of memory for a %zu byte frame\n", pool->size);
+		exit(1);
+	}
+	b = data_buf((uint8_t *)mem + pool->align);
+	b->pool = pool;
+	b->next = NULL;
+	b->refs = 0;
+	pool->allocated++;
+	if (pool->init)
+		pool->init(buf_data(b), pool->data);
+
+	return b;
+}
+
+struct frame_pool *
+frame_pool_new(size_t size, int prealloc,
+	       void (*init)(uint8_t *buf, void *data), void *data)
+{
+	struct frame_pool *pool = calloc(1, sizeof(*pool));
+	size_t page = sysconf(_SC_PAGESIZE);
+	int i;
+
+	pool->size = size;
+	pool->align = size >= page ? page : 64;
+	pool->init = init;
+	pool->data = data;
+	g_mutex_init(&pool->lock);
+	pool->stats.since = g_get_monotonic_time();
+
+	for (i = 0; i < prealloc; i++) {
+		struct frame_buf *b = alloc_buf(pool);
+
+		b->next = pool->free;
+		pool->free = b;
+	}
+
+	return pool;
+}
+
+static void
+pool_free(struct frame_pool *pool)
+{
+	g_mutex_clear(&pool->lock);
+	free(pool);
+}
+
+void
+frame_pool_destroy(struct frame_pool *pool)
+{
+	gboolean last;
+
+	g_mutex_lock(&pool->lock);
+	while (pool->free) {
+		struct frame_buf *b = pool->free;
+
+		pool->free = b->next;
+		buf_free(b);
+	}
+	pool->dead = TRUE;
+	last = !pool->in_use;
+	g_mutex_unlock(&pool->lock);
+
+	if (last)
+		pool_free(pool);
+}
+
+uint8_t *
+frame_pool_get(struct frame_pool *pool)
+{
+	struct frame_buf *b;
+	gint64 now;
+
+	g_mutex_lock(&pool->lock);
+	if (pool->free) {
+		b = pool->free;
+		pool->free = b->next;
+		pool->stats.hits++;
+	} else {
+		b = alloc_buf(pool);
+		pool->stats.misses++;
+	}
+	b->refs = 1;
+	pool->in_use++;
+	pool->stats.high_water = MAX(pool->stats.high_water, pool->in_use);
+
+	now = g_get_monotonic_time();
+	if (now - pool->stats.since >= G_USEC_PER_SEC) {
+		printf("pool: %u hits, %u misses, %d buffers of %zu bytes, high water %d\n",
+		       pool->stats.hits, pool->stats.misses, pool->allocated,
+		       pool->size, pool->stats.high_water);
+		pool->stats.hits = pool->stats.misses = 0;
+		pool->stats.since = now;
+	}
+	g_mutex_unlock(&pool->lock);
+
+	return buf_data(b);
+}
+
+const uint8_t *
+frame_buf_ref(const uint8_t *data)
+{
+	g_atomic_int_inc(&data_buf(data)->refs);
+	return data;
+}
+
+void
+frame_buf_unref(const uint8_t *data)
+{
+	struct frame_buf *b = data_buf(data);
+	struct frame_pool *pool = b->pool;
+	gboolean last;
+
+	if (!g_atomic_int_dec_and_test(&b->refs))
+		return;
+
+	g_mutex_lock(&pool->lock);
+	pool->in_use--;
+	if (pool->dead) {
+		buf_free(b);
+		last = !pool->in_use;
+		g_mutex_unlock(&pool->lock);
+		if (last)
+			pool_free(pool);
+		return;
+	}
+	b->next = pool->free;
+	pool->free = b;
+	g_mutex_unlock(&pool->lock);
+}
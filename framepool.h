@@ -0,0 +1,32 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Pool of equally sized, reference counted frame buffers. Buffers are
+ * page aligned when at least a page long and 64 byte aligned otherwise,
+ * so plane rows can be walked with full width vectors. A buffer goes
+ * back to the pool when its last reference is dropped, from any thread,
+ * and the next frame_pool_get() hands it out again without allocating.
+ */
+struct frame_pool;
+
+/*
+ * Create a pool of size byte buffers with prealloc of them ready. init,
+ * if set, runs once on every newly allocated buffer.
+ */
+struct frame_pool *frame_pool_new(size_t size, int prealloc,
+				  void (*init)(uint8_t *buf, void *data), void *data);
+
+/* Buffers still referenced are freed when their last reference goes. */
+void frame_pool_destroy(struct frame_pool *pool);
+
+/* A buffer holding one reference; its contents are whatever was last written. */
+uint8_t *frame_pool_get(struct frame_pool *pool);
+
+const uint8_t *frame_buf_ref(const uint8_t *buf);
+void frame_buf_unref(const uint8_t *buf);
+
+#endif
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framesource.h"
+
+/* Raw frames held in memory, read from a file or a tiled still. */
+struct memory_source {
+	struct frame_source base;
+	uint8_t *frames;
+};
+
+static const uint8_t *
+memory_get_frame(struct frame_source *src, unsigned int n)
+{
+	struct memory_source *m = (struct memory_source *)src;
+
+	return &m->frames[n * src->layout->frame_size];
+}
+
+static void
+memory_destroy(struct frame_source *src)
+{
+	struct memory_source *m = (struct memory_source *)src;
+
+	g_free(m->frames);
+	free(m);
+}
+
+static const struct frame_source_ops memory_ops = {
+	.name = "file",
+	.get_frame = memory_get_frame,
+	.destroy = memory_destroy,
+};
+
+struct frame_source *
+frame_source_new(const char *name, const struct tex_stream *layout,
+		 const char *filename, const uint8_t *fallback)
+{
+	struct memory_source *m;
+
+	if (!name)
+		name = filename ? "file" : "still";
+
+	if (!strcmp(name, "mmap"))
+		return frame_store_new(layout, filename, FRAME_STORE_PREFETCH);
+	if (strcmp(name, "file") && strcmp(name, "still"))
+		return generator_new(name, layout);
+
+	if (!strcmp(name, "file") && !filename) {
+		fprintf(stderr, "Error: the file source needs --file\n");
+		return NULL;
+	}
+
+	m = calloc(1, sizeof(*m));
+	m->base.ops = &memory_ops;
+	m->base.layout = layout;
+	m->frames = tex_stream_load(layout, !strcmp(name, "file") ? filename : NULL,
+				    fallback, &m->base.nframes);
+
+	return &m->base;
+}
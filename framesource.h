@@ -0,0 +1,93 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <stdint.h>
+
+#include "texstream.h"
+
+/*
+ * Frame source: produces raw frames with the layout of a tex_stream.
+ * Besides raw files and the embedded still, there are deterministic
+ * synthetic generators for load testing at any resolution and rate;
+ * frame n always has the same content.
+ */
+struct frame_source;
+
+struct frame_source_ops {
+	const char *name;
+	/* Return frame n; it stays valid until given back with release. */
+	const uint8_t *(*get_frame)(struct frame_source *src, unsigned int n);
+	/* Optional, for sources that recycle their buffers. */
+	void (*release)(struct frame_source *src, const uint8_t *frame);
+	/* Optional, frames ready ahead of the last one fetched. */
+	int (*queued)(struct frame_source *src);
+	void (*destroy)(struct frame_source *src);
+};
+
+struct frame_source {
+	const struct frame_source_ops *ops;
+	const struct tex_stream *layout;
+	int nframes;		/* 0 for an endless generator */
+};
+
+/*
+ * name is one of "still", "file", "mmap", "gradient", "noise", "scroll"
+ * or "counter". "still" tiles fallback, a 512x512 tightly packed frame of
+ * the stream format; "file" reads raw frames from filename, "mmap" maps
+ * it with the default prefetch depth. Returns NULL, with a message, for
+ * an unknown name.
+ */
+struct frame_source *frame_source_new(const char *name, const struct tex_stream *layout,
+				      const char *filename, const uint8_t *fallback);
+
+static inline const uint8_t *
+frame_source_get(struct frame_source *src, unsigned int n)
+{
+	return src->ops->get_frame(src, src->nframes ? n % src->nframes : n);
+}
+
+/*
+ * Hand a frame back once nothing reads it any more, the diff base
+ * included. Generators reuse it for a later frame.
+ */
+static inline void
+frame_source_release(struct frame_source *src, const uint8_t *frame)
+{
+	if (src->ops->release && frame)
+		src->ops->release(src, frame);
+}
+
+/* Queue depth: frames the source already holds ready, 0 if it can't tell. */
+static inline int
+frame_source_queued(struct frame_source *src)
+{
+	return src->ops->queued ? src->ops->queued(src) : 0;
+}
+
+static inline void
+frame_source_destroy(struct frame_source *src)
+{
+	src->ops->destroy(src);
+}
+
+/* Default number of frames the mmap store reads ahead. */
+#define FRAME_STORE_PREFETCH 8
+
+/*
+ * Replay filename from a mapping, see framestore.c. prefetch frames are
+ * kept resident ahead of the last one fetched; 0 populates the whole
+ * mapping up front instead.
+ */
+struct frame_source *frame_store_new(const struct tex_stream *layout, const char *filename,
+				     int prefetch);
+
+/* Synthetic generators, see generators.c. */
+struct frame_source *generator_new(const char *name, const struct tex_stream *layout);
+
+/*
+ * Rewrite a tightly packed NV12 frame, of the layout's even size, in the
+ * layout's YUV format. Meant for stills converted once, not per frame.
+ */
+void frame_from_nv12(const struct tex_stream *layout, uint8_t *dst, const uint8_t *nv12);
+
+#endif
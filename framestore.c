@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "framesource.h"
+
+/*
+ * Raw frames replayed straight from a mapping of the file. With a
+ * prefetch depth of 0 the whole file is faulted in up front; otherwise a
+ * readahead thread keeps the next frames ahead of the render cursor in
+ * the page cache and mapped, so the render thread does not block on I/O.
+ */
+struct frame_store {
+	struct frame_source base;
+	int fd;
+	uint8_t *map;
+	size_t len;
+	size_t page;
+	gboolean hugepages;
+
+	int prefetch;
+	GThread *thread;
+	GMutex lock;
+	GCond wake;
+	int cursor;		/* latest frame handed out */
+	int ahead;		/* last frame prefetched, -1 before the first */
+	gboolean quit;
+
+	struct {
+		gint64 latency;	/* us, sum over frames */
+		gint64 worst;	/* us */
+		long minflt, majflt;
+		unsigned int frames;
+		gint64 since;
+	} stats;
+};
+
+/* Fault in every page of a range; returns a value so it is not elided. */
+static uint8_t
+touch_pages(const uint8_t *p, size_t len, size_t page)
+{
+	const volatile uint8_t *v = p;
+	uint8_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < len; i += page)
+		sum += v[i];
+	if (len)
+		sum += v[len - 1];
+
+	return sum;
+}
+
+static void
+frame_range(struct frame_store *fs, int n, uint8_t **start, size_t *len)
+{
+	size_t offset = (size_t)n * fs->base.layout->frame_size;
+	size_t aligned = offset & ~(fs->page - 1);
+
+	*start = fs->map + aligned;
+	*len = offset - aligned + fs->base.layout->frame_size;
+}
+
+static gpointer
+readahead_thread(gpointer data)
+{
+	struct frame_store *fs = data;
+	int nframes = fs->base.nframes;
+	int ahead = -1;		/* last frame prefetched */
+	int cursor, i;
+
+	g_mutex_lock(&fs->lock);
+	while (!fs->quit) {
+		cursor = fs->cursor;
+		/* Frames between the cursor and ahead are already resident. */
+		i = (ahead - cursor + nframes) % nframes;
+		if (ahead < 0 || i > fs->prefetch)
+			i = 0;
+		if (i >= MIN(fs->prefetch, nframes - 1)) {
+			g_cond_wait(&fs->wake, &fs->lock);
+			continue;
+		}
+		g_mutex_unlock(&fs->lock);
+
+		for (i++; i <= MIN(fs->prefetch, nframes - 1); i++) {
+			uint8_t *start;
+			size_t len;
+
+			ahead = (cursor + i) % nframes;
+			frame_range(fs, ahead, &start, &len);
+			madvise(start, len, MADV_WILLNEED);
+			touch_pages(start, len, fs->page);
+		}
+
+		g_mutex_lock(&fs->lock);
+		fs->ahead = ahead;
+	}
+	g_mutex_unlock(&fs->lock);
+
+	return NULL;
+}
+
+static const uint8_t *
+store_get_frame(struct frame_source *src, unsigned int n)
+{
+	struct frame_store *fs = (struct frame_store *)src;
+	struct rusage before, after;
+	gint64 start, now, latency;
+	uint8_t *frame;
+	size_t len;
+
+	if (fs->thread) {
+		g_mutex_lock(&fs->lock);
+		fs->cursor = n;
+		g_cond_signal(&fs->wake);
+		g_mutex_unlock(&fs->lock);
+	}
+
+	/*
+	 * Take the faults here rather than inside the texture upload, so the
+	 * cost of reading a frame is visible on its own.
+	 */
+	frame_range(fs, n, &frame, &len);
+	getrusage(RUSAGE_THREAD, &before);
+	start = g_get_monotonic_time();
+	touch_pages(frame, len, fs->page);
+	now = g_get_monotonic_time();
+	getrusage(RUSAGE_THREAD, &after);
+
+	latency = now - start;
+	fs->stats.latency += latency;
+	fs->stats.worst = MAX(fs->stats.worst, latency);
+	fs->stats.minflt += after.ru_minflt - before.ru_minflt;
+	fs->stats.majflt += after.ru_majflt - before.ru_majflt;
+	fs->stats.frames++;
+
+	if (now - fs->stats.since >= G_USEC_PER_SEC) {
+		printf("store: %.3f ms avg, %.3f ms worst read, %.1f minor + %.1f major faults per frame\n",
+		       fs->stats.latency / 1000.0 / fs->stats.frames,
+		       fs->stats.worst / 1000.0,
+		       (double)fs->stats.minflt / fs->stats.frames,
+		       (double)fs->stats.majflt / fs->stats.frames);
+		memset(&fs->stats, 0, sizeof(fs->stats));
+		fs->stats.since = now;
+	}
+
+	return &fs->map[(size_t)n * src->layout->frame_size];
+}
+
+static int
+store_queued(struct frame_source *src)
+{
+	struct frame_store *fs = (struct frame_store *)src;
+	int n;
+
+	/* Populated up front, every frame is resident. */
+	if (!fs->thread)
+		return src->nframes - 1;
+
+	g_mutex_lock(&fs->lock);
+	n = (fs->ahead - fs->cursor + src->nframes) % src->nframes;
+	if (fs->ahead < 0 || n > fs->prefetch)
+		n = 0;
+	g_mutex_unlock(&fs->lock);
+
+	return n;
+}
+
+static void
+store_destroy(struct frame_source *src)
+{
+	struct frame_store *fs = (struct frame_store *)src;
+
+	if (fs->thread) {
+		g_mutex_lock(&fs->lock);
+		fs->quit = TRUE;
+		g_cond_signal(&fs->wake);
+		g_mutex_unlock(&fs->lock);
+		g_thread_join(fs->thread);
+	}
+	g_mutex_clear(&fs->lock);
+	g_cond_clear(&fs->wake);
+
+	munmap(fs->map, fs->len);
+	close(fs->fd);
+	free(fs);
+}
+
+static const struct frame_source_ops store_ops = {
+	.name = "mmap",
+	.get_frame = store_get_frame,
+	.queued = store_queued,
+	.destroy = store_destroy,
+};
+
+struct frame_source *
+frame_store_new(const struct tex_stream *layout, const char *filename, int prefetch)
+{
+	struct frame_store *fs;
+	struct stat st;
+	int flags = MAP_PRIVATE;
+
+	if (!filename) {
+		fprintf(stderr, "Error: the mmap source needs --file\n");
+		return NULL;
+	}
+
+	fs = calloc(1, sizeof(*fs));
+	fs->base.ops = &store_ops;
+	fs->base.layout = layout;
+	fs->page = sysconf(_SC_PAGESIZE);
+	fs->prefetch = prefetch;
+	fs->ahead = -1;
+	g_mutex_init(&fs->lock);
+	g_cond_init(&fs->wake);
+
+	fs->fd = open(filename, O_RDONLY);
+	if (fs->fd < 0 || fstat(fs->fd, &st) < 0) {
+		fprintf(stderr, "Error: %s: %s\n", filename, strerror(errno));
+		exit(1);
+	}
+	if ((size_t)st.st_size < layout->frame_size) {
+		fprintf(stderr, "Error: %s has %zu bytes, layout needs %zu\n",
+			filename, (size_t)st.st_size, layout->frame_size);
+		exit(1);
+	}
+	fs->base.nframes = st.st_size / layout->frame_size;
+	fs->len = (size_t)fs->base.nframes * layout->frame_size;
+
+#ifdef MAP_POPULATE
+	if (!prefetch)
+		flags |= MAP_POPULATE;
+#endif
+	fs->map = mmap(NULL, fs->len, PROT_READ, flags, fs->fd, 0);
+	if (fs->map == MAP_FAILED) {
+		fprintf(stderr, "Error: mmap %s: %s\n", filename, strerror(errno));
+		exit(1);
+	}
+
+	/*
+	 * File backed THP needs kernel support (CONFIG_READ_ONLY_THP_FOR_FS
+	 * or a huge tmpfs); elsewhere the advice is refused and 4k pages it is.
+	 */
+#ifdef MADV_HUGEPAGE
+	fs->hugepages = !madvise(fs->map, fs->len, MADV_HUGEPAGE);
+#endif
+	madvise(fs->map, fs->len, prefetch ? MADV_SEQUENTIAL : MADV_WILLNEED);
+
+	if (prefetch > 0 && fs->base.nframes > 1)
+		fs->thread = g_thread_new("readahead", readahead_thread, fs);
+
+	printf("store: %s, %d frames of %zu bytes, %s, hugepages %s\n",
+	       filename, fs->base.nframes, layout->frame_size,
+	       prefetch ? "readahead thread" : "populated",
+	       fs->hugepages ? "advised" : "unavailable");
+	fs->stats.since = g_get_monotonic_time();
+
+	return &fs->base;
+}
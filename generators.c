@@ -0,0 +1,420 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+#include "framepool.h"
+#include "framesource.h"
+
+/*
+ * Synthetic frame generators. They write 16 or 32 bytes at a time with
+ * GCC vector extensions (SSE2/AVX or NEON), and the text generators only
+ * repaint the part of the frame that moves, so producing a frame costs
+ * far less than uploading it.
+ */
+typedef uint8_t v16u8 __attribute__((vector_size(16)));
+typedef uint64_t v4u64 __attribute__((vector_size(32)));
+
+struct generator {
+	struct frame_source base;
+	void (*render)(struct generator *g, uint8_t *frame, unsigned int n);
+	struct frame_pool *pool;
+
+	/* scroll and counter */
+	int scale;		/* luma pixels per font pixel */
+	int x0, y0, w, h;	/* moving area, in luma pixels */
+	uint8_t *strip[TEX_MAX_PLANES];
+	int strip_w;		/* in luma pixels */
+};
+
+static const char scroll_text[] = "JUST GLSTUFF - SCROLLING TEXT SOURCE - 0123456789 - ";
+
+/*
+ * Texel of plane i of a YUV layout for luma y and chroma u, v, 8 bit
+ * values; dy is added to the second luma sample of a packed texel.
+ * 16 bit formats get the value in their top byte.
+ */
+static void
+yuv_texel(const struct tex_stream *l, int i, int y, int dy, int u, int v, uint8_t t[4])
+{
+	memset(t, 0, 4);
+	switch (l->format) {
+	case TEX_FORMAT_RGBA:
+		break;
+	case TEX_FORMAT_NV12:
+	case TEX_FORMAT_NV21:
+		if (i == 0)
+			t[0] = y;
+		else if (l->format == TEX_FORMAT_NV12)
+			memcpy(t, (uint8_t[]){ u, v }, 2);
+		else
+			memcpy(t, (uint8_t[]){ v, u }, 2);
+		break;
+	case TEX_FORMAT_I420:
+	case TEX_FORMAT_YV12:
+		t[0] = i == 0 ? y : (i == 1) == (l->format == TEX_FORMAT_I420) ? u : v;
+		break;
+	case TEX_FORMAT_YUYV:
+		memcpy(t, (uint8_t[]){ y, u, y + dy, v }, 4);
+		break;
+	case TEX_FORMAT_UYVY:
+		memcpy(t, (uint8_t[]){ u, y, v, y + dy }, 4);
+		break;
+	case TEX_FORMAT_P010:
+		if (i == 0)
+			t[1] = y;
+		else
+			memcpy(t, (uint8_t[]){ 0, u, 0, v }, 4);
+		break;
+	}
+}
+
+/* Background and foreground texels of plane i. */
+static void
+plane_colors(const struct tex_stream *l, int i, uint8_t bg[4], uint8_t fg[4])
+{
+	if (l->format == TEX_FORMAT_RGBA) {
+		memcpy(bg, (uint8_t[]){ 0, 0, 0, 255 }, 4);
+		memcpy(fg, (uint8_t[]){ 255, 255, 255, 255 }, 4);
+	} else {
+		yuv_texel(l, i, 16, 0, 128, 128, bg);
+		yuv_texel(l, i, 235, 0, 128, 128, fg);
+	}
+}
+
+/* Write count copies of a bpp sized texel; bpp divides 16. */
+static void
+fill_texels(uint8_t *dst, const uint8_t *texel, int bpp, int count)
+{
+	int n = count * bpp, i;
+	v16u8 v;
+
+	for (i = 0; i < 16; i++)
+		v[i] = texel[i % bpp];
+	for (i = 0; i + 16 <= n; i += 16)
+		memcpy(&dst[i], &v, 16);
+	memcpy(&dst[i], &v, n - i);
+}
+
+/*
+ * Write count texels where component c of texel x is
+ * start[c] + x * step[c] (mod 256).
+ */
+static void
+fill_ramp(uint8_t *dst, const uint8_t *start, const uint8_t *step, int bpp, int count)
+{
+	int n = count * bpp, i;
+	v16u8 cur, inc;
+
+	for (i = 0; i < 16; i++) {
+		cur[i] = start[i % bpp] + (i / bpp) * step[i % bpp];
+		inc[i] = (16 / bpp) * step[i % bpp];
+	}
+	for (i = 0; i + 16 <= n; i += 16) {
+		memcpy(&dst[i], &cur, 16);
+		cur += inc;
+	}
+	memcpy(&dst[i], &cur, n - i);
+}
+
+static void
+fill_plane(const struct tex_plane *p, uint8_t *dst, const uint8_t *texel)
+{
+	int y;
+
+	for (y = 0; y < p->height; y++)
+		fill_texels(&dst[(size_t)y * p->pitch], texel, p->bpp, p->width);
+}
+
+static const uint8_t *
+generator_get_frame(struct frame_source *src, unsigned int n)
+{
+	struct generator *g = (struct generator *)src;
+	uint8_t *frame = frame_pool_get(g->pool);
+
+	g->render(g, frame, n);
+
+	return frame;
+}
+
+static void
+generator_release(struct frame_source *src, const uint8_t *frame)
+{
+	(void)src;
+	frame_buf_unref(frame);
+}
+
+static void
+generator_destroy(struct frame_source *src)
+{
+	struct generator *g = (struct generator *)src;
+	int i;
+
+	for (i = 0; i < TEX_MAX_PLANES; i++)
+		free(g->strip[i]);
+	frame_pool_destroy(g->pool);
+	free(g);
+}
+
+static const struct frame_source_ops generator_ops = {
+	.name = "generator",
+	.get_frame = generator_get_frame,
+	.release = generator_release,
+	.destroy = generator_destroy,
+};
+
+/* Diagonal gradient moving by two pixels per frame. */
+static void
+render_gradient(struct generator *g, uint8_t *frame, unsigned int n)
+{
+	const struct tex_stream *l = g->base.layout;
+	int i, y;
+
+	for (i = 0; i < l->nplanes; i++) {
+		const struct tex_plane *p = &l->planes[i];
+		uint8_t start[4], step[4] = { 1, 0, 255, 0 };
+
+		/* Luma y + 2n + x, chroma u = n + x and v = y, at chroma resolution. */
+		if (l->format != TEX_FORMAT_RGBA)
+			yuv_texel(l, i, p->hsub, 0, p->hsub, 0, step);
+
+		for (y = 0; y < p->height; y++) {
+			if (l->format == TEX_FORMAT_RGBA)
+				memcpy(start, (uint8_t[]){ 2 * n, y, 255 - 2 * n, 255 }, 4);
+			else
+				yuv_texel(l, i, y * p->vsub + 2 * n, 1, n, y * p->vsub / 2 * 2, start);
+			fill_ramp(&frame[p->offset + (size_t)y * p->pitch], start, step, p->bpp, p->width);
+		}
+	}
+}
+
+static uint64_t
+splitmix64(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ull;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+/* White noise, four xorshift64 lanes seeded from the frame number. */
+static void
+render_noise(struct generator *g, uint8_t *frame, unsigned int n)
+{
+	const struct tex_stream *l = g->base.layout;
+	int i, j;
+
+	for (i = 0; i < l->nplanes; i++) {
+		const struct tex_plane *p = &l->planes[i];
+		uint8_t *dst = &frame[p->offset];
+		size_t size = (size_t)p->pitch * p->height, k;
+		v4u64 s, alpha = { 0 };
+
+		for (j = 0; j < 4; j++)
+			s[j] = splitmix64(((uint64_t)n * TEX_MAX_PLANES + i) * 4 + j) | 1;
+		if (l->format == TEX_FORMAT_RGBA)
+			alpha += 0xff000000ff000000ull;
+
+		for (k = 0; k < size; k += 32) {
+			v4u64 v;
+
+			s ^= s << 13;
+			s ^= s >> 7;
+			s ^= s << 17;
+			v = s | alpha;
+			memcpy(&dst[k], &v, MIN(size - k, 32));
+		}
+	}
+}
+
+/* Paint rows [y0, y0 + h) of plane i with the moving text strip. */
+static void
+render_scroll(struct generator *g, uint8_t *frame, unsigned int n)
+{
+	const struct tex_stream *l = g->base.layout;
+	int off = (n * 2 * g->scale) % g->strip_w;
+	int i, y;
+
+	for (i = 0; i < l->nplanes; i++) {
+		const struct tex_plane *p = &l->planes[i];
+		int strip_w = g->strip_w / p->hsub;
+		int x0 = off / p->hsub;
+
+		for (y = 0; y < g->h / p->vsub; y++) {
+			const uint8_t *src = &g->strip[i][(size_t)y * strip_w * p->bpp];
+			uint8_t *dst = &frame[p->offset + (size_t)(g->y0 / p->vsub + y) * p->pitch];
+			int x = 0, sx = x0;
+
+			while (x < p->width) {
+				int run = MIN(strip_w - sx, p->width - x);
+
+				memcpy(&dst[x * p->bpp], &src[sx * p->bpp], run * p->bpp);
+				x += run;
+				sx = 0;
+			}
+		}
+	}
+}
+
+/* Frame number as eight big digits in the top left corner. */
+static void
+render_counter(struct generator *g, uint8_t *frame, unsigned int n)
+{
+	const struct tex_stream *l = g->base.layout;
+	char digits[16];
+	int i, y, c, col;
+
+	snprintf(digits, sizeof(digits), "%08u", n % 100000000u);
+
+	for (i = 0; i < l->nplanes; i++) {
+		const struct tex_plane *p = &l->planes[i];
+		int run = g->scale / p->hsub;
+		uint8_t bg[4], fg[4];
+
+		plane_colors(l, i, bg, fg);
+
+		for (y = 0; y < g->h / p->vsub; y++) {
+			uint8_t *dst = &frame[p->offset + (size_t)(g->y0 / p->vsub + y) * p->pitch +
+					      (size_t)(g->x0 / p->hsub) * p->bpp];
+			int row = y * p->vsub / g->scale;
+
+			for (c = 0; c < 8; c++) {
+				uint8_t bits = font_glyph(digits[c])[row];
+
+				for (col = 0; col < FONT_WIDTH + 1; col++) {
+					int on = col < FONT_WIDTH && (bits & (1 << (FONT_WIDTH - 1 - col)));
+
+					fill_texels(dst, on ? fg : bg, p->bpp, run);
+					dst += run * p->bpp;
+				}
+			}
+		}
+	}
+}
+
+/* The text generators only repaint what moves, start from a blank frame. */
+static void
+blank_frame(uint8_t *frame, void *data)
+{
+	const struct tex_stream *l = data;
+	int i;
+
+	for (i = 0; i < l->nplanes; i++) {
+		uint8_t bg[4], fg[4];
+
+		plane_colors(l, i, bg, fg);
+		fill_plane(&l->planes[i], &frame[l->planes[i].offset], bg);
+	}
+}
+
+/* Pre-render the scrolling text at its final scale, one strip per plane. */
+static void
+build_strip(struct generator *g)
+{
+	const struct tex_stream *l = g->base.layout;
+	int len = strlen(scroll_text);
+	int i, x, y;
+
+	g->strip_w = len * (FONT_WIDTH + 1) * g->scale;
+
+	for (i = 0; i < l->nplanes; i++) {
+		const struct tex_plane *p = &l->planes[i];
+		int w = g->strip_w / p->hsub, h = g->h / p->vsub;
+		uint8_t bg[4], fg[4];
+
+		plane_colors(l, i, bg, fg);
+		g->strip[i] = malloc((size_t)w * h * p->bpp);
+
+		for (y = 0; y < h; y++) {
+			int row = y * p->vsub / g->scale;
+
+			for (x = 0; x < w; x++) {
+				int fx = x * p->hsub / g->scale;
+				int col = fx % (FONT_WIDTH + 1);
+				uint8_t bits = font_glyph(scroll_text[fx / (FONT_WIDTH + 1)])[row];
+				int on = col < FONT_WIDTH && (bits & (1 << (FONT_WIDTH - 1 - col)));
+
+				memcpy(&g->strip[i][((size_t)y * w + x) * p->bpp], on ? fg : bg, p->bpp);
+			}
+		}
+	}
+}
+
+void
+frame_from_nv12(const struct tex_stream *l, uint8_t *dst, const uint8_t *nv12)
+{
+	const uint8_t *uv = &nv12[(size_t)l->width * l->height];
+	int i, x, y;
+
+	for (i = 0; i < l->nplanes; i++) {
+		const struct tex_plane *p = &l->planes[i];
+
+		for (y = 0; y < p->height; y++) {
+			uint8_t *row = &dst[p->offset + (size_t)y * p->pitch];
+			int ly = y * p->vsub;
+
+			for (x = 0; x < p->width; x++) {
+				int lx = x * p->hsub;
+				const uint8_t *luma = &nv12[(size_t)ly * l->width + lx];
+				const uint8_t *c = &uv[(size_t)(ly / 2) * l->width + lx / 2 * 2];
+				uint8_t t[4];
+
+				yuv_texel(l, i, luma[0], luma[p->hsub - 1] - luma[0], c[0], c[1], t);
+				memcpy(&row[x * p->bpp], t, p->bpp);
+			}
+		}
+	}
+}
+
+struct frame_source *
+generator_new(const char *name, const struct tex_stream *layout)
+{
+	struct generator *g;
+
+	g = calloc(1, sizeof(*g));
+	g->base.ops = &generator_ops;
+	g->base.layout = layout;
+	g->base.nframes = 0;
+
+	if (!strcmp(name, "gradient")) {
+		g->render = render_gradient;
+	} else if (!strcmp(name, "noise")) {
+		g->render = render_noise;
+	} else if (!strcmp(name, "scroll")) {
+		/* Scales and positions are even so chroma lines up with luma. */
+		g->render = render_scroll;
+		g->scale = MAX(2, layout->height / 120 & ~1);
+		g->h = FONT_HEIGHT * g->scale;
+		g->y0 = (layout->height - g->h) / 2 & ~1;
+		if (g->y0 < 0) {
+			fprintf(stderr, "Error: frame too small for the scroll source\n");
+			free(g);
+			return NULL;
+		}
+		build_strip(g);
+	} else if (!strcmp(name, "counter")) {
+		g->render = render_counter;
+		g->scale = MAX(2, layout->height / 40 & ~1);
+		g->x0 = g->y0 = 2 * g->scale;
+		g->w = 8 * (FONT_WIDTH + 1) * g->scale;
+		g->h = FONT_HEIGHT * g->scale;
+		if (g->x0 + g->w > layout->width || g->y0 + g->h > layout->height) {
+			fprintf(stderr, "Error: frame too small for the counter source\n");
+			free(g);
+			return NULL;
+		}
+	} else {
+		fprintf(stderr, "Error: unknown frame source '%s', try still, file, "
+			"gradient, noise, scroll or counter\n", name);
+		free(g);
+		return NULL;
+	}
+
+	/*
+	 * The shown frame and the one being uploaded are all that is in
+	 * flight, so two buffers cover steady state.
+	 */
+	g->pool = frame_pool_new(layout->frame_size, 2, blank_frame, (void *)layout);
+
+	return &g->base;
+}
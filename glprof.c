@@ -0,0 +1,402 @@
+/*
+ * GL and EGL call profiler, preloaded in front of the driver:
+ *
+ *   LD_PRELOAD=./libglprof.so ./gtkegles_tex_nv12 --hud
+ *
+ * Every GL and EGL entry point the gtkegles demos and the core library
+ * use is wrapped here; the real one comes from eglGetProcAddress (GL) or
+ * the next library in the search order (EGL), looked up on first call.
+ * eglGetProcAddress itself hands out the wrappers of the extension
+ * functions the demos load through it. A swap ends a frame; every
+ * GLPROF_PERIOD seconds (default 1, 0 for only at exit) the calls and
+ * time per frame of each entry point are printed to stderr, highest
+ * cumulative time first, GLPROF_TOP rows (default 12), and the whole
+ * run once more at exit. Time spent in a swap includes waiting for
+ * vsync.
+ */
+#define _GNU_SOURCE
+#define EGL_EGLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+/*
+ * F(return type, name, parameters, arguments) for the functions that
+ * return something, V(name, parameters, arguments) for the others.
+ */
+#define EGL_ENTRY_POINTS(F, V) \
+	F(EGLBoolean, eglBindAPI, (EGLenum api), (api)) \
+	F(EGLBoolean, eglChooseConfig, (EGLDisplay dpy, const EGLint *attrib_list, EGLConfig *configs, \
+		EGLint config_size, EGLint *num_config), (dpy, attrib_list, configs, config_size, num_config)) \
+	F(EGLContext, eglCreateContext, (EGLDisplay dpy, EGLConfig config, EGLContext share_context, \
+		const EGLint *attrib_list), (dpy, config, share_context, attrib_list)) \
+	F(EGLSurface, eglCreatePbufferSurface, (EGLDisplay dpy, EGLConfig config, const EGLint *attrib_list), \
+		(dpy, config, attrib_list)) \
+	F(EGLSurface, eglCreateWindowSurface, (EGLDisplay dpy, EGLConfig config, EGLNativeWindowType win, \
+		const EGLint *attrib_list), (dpy, config, win, attrib_list)) \
+	F(EGLDisplay, eglGetCurrentDisplay, (void), ()) \
+	F(EGLDisplay, eglGetDisplay, (EGLNativeDisplayType display_id), (display_id)) \
+	F(EGLint, eglGetError, (void), ()) \
+	F(EGLDisplay, eglGetPlatformDisplayEXT, (EGLenum platform, void *native_display, \
+		const EGLint *attrib_list), (platform, native_display, attrib_list)) \
+	F(EGLBoolean, eglInitialize, (EGLDisplay dpy, EGLint *major, EGLint *minor), (dpy, major, minor)) \
+	F(EGLBoolean, eglMakeCurrent, (EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx), \
+		(dpy, draw, read, ctx)) \
+	F(const char *, eglQueryString, (EGLDisplay dpy, EGLint name), (dpy, name)) \
+	F(EGLBoolean, eglQuerySurface, (EGLDisplay dpy, EGLSurface surface, EGLint attribute, EGLint *value), \
+		(dpy, surface, attribute, value)) \
+	F(EGLBoolean, eglSwapInterval, (EGLDisplay dpy, EGLint interval), (dpy, interval))
+
+/* The swaps end a frame. */
+#define SWAP_ENTRY_POINTS(F, V) \
+	F(EGLBoolean, eglSwapBuffers, (EGLDisplay dpy, EGLSurface surface), (dpy, surface)) \
+	F(EGLBoolean, eglSwapBuffersWithDamageEXT, (EGLDisplay dpy, EGLSurface surface, \
+		const EGLint *rects, EGLint n_rects), (dpy, surface, rects, n_rects)) \
+	F(EGLBoolean, eglSwapBuffersWithDamageKHR, (EGLDisplay dpy, EGLSurface surface, \
+		const EGLint *rects, EGLint n_rects), (dpy, surface, rects, n_rects))
+
+#define GL_ENTRY_POINTS(F, V) \
+	V(glActiveTexture, (GLenum texture), (texture)) \
+	V(glAttachShader, (GLuint program, GLuint shader), (program, shader)) \
+	V(glBeginTransformFeedback, (GLenum primitiveMode), (primitiveMode)) \
+	V(glBindAttribLocation, (GLuint program, GLuint index, const GLchar *name), (program, index, name)) \
+	V(glBindBuffer, (GLenum target, GLuint buffer), (target, buffer)) \
+	V(glBindBufferBase, (GLenum target, GLuint index, GLuint buffer), (target, index, buffer)) \
+	V(glBindFramebuffer, (GLenum target, GLuint framebuffer), (target, framebuffer)) \
+	V(glBindTexture, (GLenum target, GLuint texture), (target, texture)) \
+	V(glBindTransformFeedback, (GLenum target, GLuint id), (target, id)) \
+	V(glBindVertexArray, (GLuint array), (array)) \
+	V(glBlendFunc, (GLenum sfactor, GLenum dfactor), (sfactor, dfactor)) \
+	V(glBufferData, (GLenum target, GLsizeiptr size, const void *data, GLenum usage), \
+		(target, size, data, usage)) \
+	V(glBufferStorageEXT, (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags), \
+		(target, size, data, flags)) \
+	V(glBufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void *data), \
+		(target, offset, size, data)) \
+	F(GLenum, glCheckFramebufferStatus, (GLenum target), (target)) \
+	V(glClear, (GLbitfield mask), (mask)) \
+	V(glClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha), (red, green, blue, alpha)) \
+	F(GLenum, glClientWaitSync, (GLsync sync, GLbitfield flags, GLuint64 timeout), (sync, flags, timeout)) \
+	V(glCompileShader, (GLuint shader), (shader)) \
+	V(glCompressedTexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, \
+		GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void *data), \
+		(target, level, xoffset, yoffset, width, height, format, imageSize, data)) \
+	F(GLuint, glCreateProgram, (void), ()) \
+	F(GLuint, glCreateShader, (GLenum type), (type)) \
+	V(glDeleteBuffers, (GLsizei n, const GLuint *buffers), (n, buffers)) \
+	V(glDeleteFramebuffers, (GLsizei n, const GLuint *framebuffers), (n, framebuffers)) \
+	V(glDeleteShader, (GLuint shader), (shader)) \
+	V(glDeleteSync, (GLsync sync), (sync)) \
+	V(glDeleteTextures, (GLsizei n, const GLuint *textures), (n, textures)) \
+	V(glDeleteVertexArrays, (GLsizei n, const GLuint *arrays), (n, arrays)) \
+	V(glDetachShader, (GLuint program, GLuint shader), (program, shader)) \
+	V(glDisable, (GLenum cap), (cap)) \
+	V(glDisableVertexAttribArray, (GLuint index), (index)) \
+	V(glDrawArrays, (GLenum mode, GLint first, GLsizei count), (mode, first, count)) \
+	V(glDrawArraysInstanced, (GLenum mode, GLint first, GLsizei count, GLsizei instancecount), \
+		(mode, first, count, instancecount)) \
+	V(glDrawElements, (GLenum mode, GLsizei count, GLenum type, const void *indices), \
+		(mode, count, type, indices)) \
+	V(glEnable, (GLenum cap), (cap)) \
+	V(glEnableVertexAttribArray, (GLuint index), (index)) \
+	V(glEndTransformFeedback, (void), ()) \
+	F(GLsync, glFenceSync, (GLenum condition, GLbitfield flags), (condition, flags)) \
+	V(glFinish, (void), ()) \
+	V(glFramebufferTexture2D, (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, \
+		GLint level), (target, attachment, textarget, texture, level)) \
+	V(glFramebufferTextureLayer, (GLenum target, GLenum attachment, GLuint texture, GLint level, \
+		GLint layer), (target, attachment, texture, level, layer)) \
+	V(glGenBuffers, (GLsizei n, GLuint *buffers), (n, buffers)) \
+	V(glGenFramebuffers, (GLsizei n, GLuint *framebuffers), (n, framebuffers)) \
+	V(glGenTextures, (GLsizei n, GLuint *textures), (n, textures)) \
+	V(glGenTransformFeedbacks, (GLsizei n, GLuint *ids), (n, ids)) \
+	V(glGenVertexArrays, (GLsizei n, GLuint *arrays), (n, arrays)) \
+	V(glGenerateMipmap, (GLenum target), (target)) \
+	F(GLenum, glGetError, (void), ()) \
+	V(glGetIntegerv, (GLenum pname, GLint *data), (pname, data)) \
+	V(glGetProgramInfoLog, (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog), \
+		(program, bufSize, length, infoLog)) \
+	V(glGetProgramiv, (GLuint program, GLenum pname, GLint *params), (program, pname, params)) \
+	V(glGetShaderInfoLog, (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog), \
+		(shader, bufSize, length, infoLog)) \
+	V(glGetShaderiv, (GLuint shader, GLenum pname, GLint *params), (shader, pname, params)) \
+	F(const GLubyte *, glGetString, (GLenum name), (name)) \
+	F(GLint, glGetUniformLocation, (GLuint program, const GLchar *name), (program, name)) \
+	V(glLinkProgram, (GLuint program), (program)) \
+	F(void *, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access), \
+		(target, offset, length, access)) \
+	V(glPixelStorei, (GLenum pname, GLint param), (pname, param)) \
+	V(glReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, \
+		void *pixels), (x, y, width, height, format, type, pixels)) \
+	V(glScissor, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height)) \
+	V(glShaderSource, (GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length), \
+		(shader, count, string, length)) \
+	V(glTexParameteri, (GLenum target, GLenum pname, GLint param), (target, pname, param)) \
+	V(glTexStorage2D, (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, \
+		GLsizei height), (target, levels, internalformat, width, height)) \
+	V(glTexStorage3D, (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, \
+		GLsizei height, GLsizei depth), (target, levels, internalformat, width, height, depth)) \
+	V(glTexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, \
+		GLsizei height, GLenum format, GLenum type, const void *pixels), \
+		(target, level, xoffset, yoffset, width, height, format, type, pixels)) \
+	V(glTexSubImage3D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, \
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels), \
+		(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels)) \
+	V(glTransformFeedbackVaryings, (GLuint program, GLsizei count, const GLchar *const *varyings, \
+		GLenum bufferMode), (program, count, varyings, bufferMode)) \
+	V(glUniform1f, (GLint location, GLfloat v0), (location, v0)) \
+	V(glUniform1i, (GLint location, GLint v0), (location, v0)) \
+	V(glUniform2f, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1)) \
+	V(glUniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value), \
+		(location, count, transpose, value)) \
+	F(GLboolean, glUnmapBuffer, (GLenum target), (target)) \
+	V(glUseProgram, (GLuint program), (program)) \
+	V(glVertexAttrib4fv, (GLuint index, const GLfloat *v), (index, v)) \
+	V(glVertexAttribDivisor, (GLuint index, GLuint divisor), (index, divisor)) \
+	V(glVertexAttribPointer, (GLuint index, GLint size, GLenum type, GLboolean normalized, \
+		GLsizei stride, const void *pointer), (index, size, type, normalized, stride, pointer)) \
+	V(glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+
+#define ALL_ENTRY_POINTS(F, V) \
+	EGL_ENTRY_POINTS(F, V) \
+	SWAP_ENTRY_POINTS(F, V) \
+	GL_ENTRY_POINTS(F, V) \
+	F(__eglMustCastToProperFunctionPointerType, eglGetProcAddress, (const char *procname), (procname))
+
+#define ID_F(ret, name, params, args) ID_##name,
+#define ID_V(name, params, args) ID_##name,
+enum { ALL_ENTRY_POINTS(ID_F, ID_V) ID_COUNT };
+
+struct entry {
+	const char *name;
+	void *real;
+	void *wrapper;
+	uint64_t calls, ns;		/* this period */
+	uint64_t total_calls, total_ns;	/* whole run */
+};
+
+#define DECL_F(ret, name, params, args) ret name params;
+#define DECL_V(name, params, args) void name params;
+ALL_ENTRY_POINTS(DECL_F, DECL_V)
+
+#define ENTRY_F(ret, name, params, args) [ID_##name] = { #name, NULL, (void *)name },
+#define ENTRY_V(name, params, args) [ID_##name] = { #name, NULL, (void *)name },
+static struct entry entries[ID_COUNT] = { ALL_ENTRY_POINTS(ENTRY_F, ENTRY_V) };
+
+static uint64_t period_start, overhead_ns;
+static unsigned int frames, total_frames;
+static double period_s = 1;
+static int top = 12;
+
+static inline uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static __eglMustCastToProperFunctionPointerType
+real_get_proc_address(const char *name)
+{
+	struct entry *e = &entries[ID_eglGetProcAddress];
+
+	if (!e->real)
+		e->real = dlsym(RTLD_NEXT, "eglGetProcAddress");
+	if (!e->real)
+		return NULL;
+	return ((__eglMustCastToProperFunctionPointerType (*)(const char *))e->real)(name);
+}
+
+static void *
+resolve(int id)
+{
+	struct entry *e = &entries[id];
+
+	if (strncmp(e->name, "egl", 3) == 0)
+		e->real = dlsym(RTLD_NEXT, e->name);
+	else
+		e->real = (void *)real_get_proc_address(e->name);
+	if (!e->real)
+		e->real = dlsym(RTLD_NEXT, e->name);
+	if (!e->real && strncmp(e->name, "egl", 3) == 0)
+		e->real = (void *)real_get_proc_address(e->name);
+	if (!e->real) {
+		fprintf(stderr, "Error: glprof: no %s to forward to\n", e->name);
+		exit(1);
+	}
+	return e->real;
+}
+
+static inline void
+account(int id, uint64_t start)
+{
+	entries[id].calls++;
+	entries[id].ns += now_ns() - start;
+}
+
+static int
+by_time(const void *a, const void *b)
+{
+	const struct entry *x = *(const struct entry *const *)a, *y = *(const struct entry *const *)b;
+
+	return x->ns < y->ns ? 1 : x->ns > y->ns ? -1 : strcmp(x->name, y->name);
+}
+
+/* The entries with calls, highest time first; ns and calls are of the span printed. */
+static void
+print_profile(const char *what, unsigned int nframes, int rows)
+{
+	struct entry *sorted[ID_COUNT];
+	uint64_t calls = 0, ns = 0;
+	int i, n = 0;
+	double f = nframes ? nframes : 1;
+
+	for (i = 0; i < ID_COUNT; i++) {
+		if (!entries[i].calls)
+			continue;
+		sorted[n++] = &entries[i];
+		calls += entries[i].calls;
+		ns += entries[i].ns;
+	}
+	qsort(sorted, n, sizeof(sorted[0]), by_time);
+
+	fprintf(stderr, "glprof: %s, %u frames, %.1f calls and %.3f ms in GL and EGL per frame "
+		"(%.0f ns of each call is timing)\n",
+		what, nframes, calls / f, ns / 1e6 / f, (double)overhead_ns);
+	for (i = 0; i < n && (rows <= 0 || i < rows); i++)
+		fprintf(stderr, "glprof:   %-30s %9.1f calls %9.3f ms %5.1f%%\n", sorted[i]->name,
+			sorted[i]->calls / f, sorted[i]->ns / 1e6 / f,
+			ns ? 100.0 * sorted[i]->ns / ns : 0.0);
+}
+
+/* Fold the period into the run totals and start a new one. */
+static void
+end_period(uint64_t now)
+{
+	int i;
+
+	for (i = 0; i < ID_COUNT; i++) {
+		entries[i].total_calls += entries[i].calls;
+		entries[i].total_ns += entries[i].ns;
+		entries[i].calls = entries[i].ns = 0;
+	}
+	total_frames += frames;
+	frames = 0;
+	period_start = now;
+}
+
+static void
+frame_done(void)
+{
+	uint64_t now = now_ns();
+
+	frames++;
+	if (!period_start)
+		period_start = now;
+	if (period_s > 0 && now - period_start >= period_s * 1e9) {
+		print_profile("per frame", frames, top);
+		end_period(now);
+	}
+}
+
+__attribute__((constructor)) static void
+glprof_init(void)
+{
+	const char *s;
+	uint64_t start;
+	int i;
+
+	if ((s = getenv("GLPROF_PERIOD")))
+		period_s = atof(s);
+	if ((s = getenv("GLPROF_TOP")))
+		top = atoi(s);
+
+	/* What a wrapper adds to the time it measures, about one clock read. */
+	start = now_ns();
+	for (i = 0; i < 1000; i++)
+		now_ns();
+	overhead_ns = (now_ns() - start) / 1000;
+}
+
+__attribute__((destructor)) static void
+glprof_fini(void)
+{
+	uint64_t calls = 0;
+	int i;
+
+	end_period(now_ns());
+	for (i = 0; i < ID_COUNT; i++)
+		calls += entries[i].total_calls;
+	/* Preloading reaches every child process too, most never touch GL. */
+	if (!calls)
+		return;
+	for (i = 0; i < ID_COUNT; i++) {
+		entries[i].calls = entries[i].total_calls;
+		entries[i].ns = entries[i].total_ns;
+	}
+	print_profile("whole run", total_frames, 0);
+}
+
+#define WRAP_F(ret, name, params, args) \
+ret name params \
+{ \
+	ret (*real) params = entries[ID_##name].real ? entries[ID_##name].real : resolve(ID_##name); \
+	uint64_t start = now_ns(); \
+	ret r = real args; \
+	account(ID_##name, start); \
+	return r; \
+}
+#define WRAP_V(name, params, args) \
+void name params \
+{ \
+	void (*real) params = entries[ID_##name].real ? entries[ID_##name].real : resolve(ID_##name); \
+	uint64_t start = now_ns(); \
+	real args; \
+	account(ID_##name, start); \
+}
+EGL_ENTRY_POINTS(WRAP_F, WRAP_V)
+GL_ENTRY_POINTS(WRAP_F, WRAP_V)
+
+#define WRAP_SWAP(ret, name, params, args) \
+ret name params \
+{ \
+	ret (*real) params = entries[ID_##name].real ? entries[ID_##name].real : resolve(ID_##name); \
+	uint64_t start = now_ns(); \
+	ret r = real args; \
+	account(ID_##name, start); \
+	frame_done(); \
+	return r; \
+}
+SWAP_ENTRY_POINTS(WRAP_SWAP, WRAP_V)
+
+/* Wrappers for what is wrapped, so that loaded extensions are counted too. */
+__eglMustCastToProperFunctionPointerType
+eglGetProcAddress(const char *procname)
+{
+	uint64_t start = now_ns();
+	__eglMustCastToProperFunctionPointerType p = real_get_proc_address(procname);
+	int i;
+
+	account(ID_eglGetProcAddress, start);
+	if (!p)
+		return NULL;
+	for (i = 0; i < ID_COUNT; i++) {
+		if (i == ID_eglGetProcAddress || strcmp(entries[i].name, procname) != 0)
+			continue;
+		if (!entries[i].real)
+			entries[i].real = (void *)p;
+		return (__eglMustCastToProperFunctionPointerType)entries[i].wrapper;
+	}
+	return p;
+}
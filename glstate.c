@@ -0,0 +1,339 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "glstate.h"
+
+#define UNKNOWN ((GLuint)~0u)
+/* Uniforms remembered, direct mapped by program and location. */
+#define GL_STATE_UNIFORMS 64
+
+struct attrib_pointer {
+	gboolean known;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	const void *pointer;
+};
+
+struct uniform {
+	GLuint program;		/* 0 for an empty slot */
+	GLint location;
+	gboolean is_float;
+	union {
+		GLint i;
+		GLfloat f;
+	} v;
+};
+
+static gboolean enabled;
+
+static struct {
+	GLuint program;
+	GLenum unit;		/* 0 when unknown */
+	GLuint textures[GL_STATE_UNITS][2];	/* 2D, 2D array */
+	GLuint framebuffer;
+	gboolean viewport_known, clear_known;
+	GLint viewport[4];
+	GLfloat clear[4];
+	GLuint vao;
+	unsigned int attribs_known, attribs_on;	/* vertex array 0 */
+	struct attrib_pointer pointers[GL_STATE_ATTRIBS];
+	struct uniform uniforms[GL_STATE_UNIFORMS];
+} shadow;
+
+static struct {
+	unsigned int issued, elided, frames;
+	gint64 since;
+} stats;
+
+/* Count the call, TRUE when it can be dropped. */
+static inline gboolean
+redundant(gboolean same)
+{
+	if (enabled && same) {
+		stats.elided++;
+		return TRUE;
+	}
+	stats.issued++;
+	return FALSE;
+}
+
+void
+gl_state_invalidate(void)
+{
+	int i, j;
+
+	memset(&shadow, 0, sizeof(shadow));
+	shadow.program = shadow.vao = shadow.framebuffer = UNKNOWN;
+	for (i = 0; i < GL_STATE_UNITS; i++)
+		for (j = 0; j < 2; j++)
+			shadow.textures[i][j] = UNKNOWN;
+}
+
+void
+gl_state_enable(gboolean enable)
+{
+	enabled = enable;
+	gl_state_invalidate();
+}
+
+GLuint
+gl_state_program(void)
+{
+	GLint program;
+
+	if (enabled && shadow.program != UNKNOWN)
+		return shadow.program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	if (enabled)
+		shadow.program = program;
+	return program;
+}
+
+void
+gl_state_use_program(GLuint program)
+{
+	if (redundant(shadow.program == program))
+		return;
+	glUseProgram(program);
+	shadow.program = program;
+}
+
+static struct uniform *
+uniform_slot(GLint location)
+{
+	return &shadow.uniforms[(shadow.program * 31u + location) % GL_STATE_UNIFORMS];
+}
+
+void
+gl_state_uniform1i(GLint location, GLint v)
+{
+	struct uniform *u = uniform_slot(location);
+	gboolean known = shadow.program != UNKNOWN && shadow.program != 0 && location >= 0;
+
+	if (redundant(known && u->program == shadow.program && u->location == location &&
+		      !u->is_float && u->v.i == v))
+		return;
+	glUniform1i(location, v);
+	if (known)
+		*u = (struct uniform){ shadow.program, location, FALSE, { .i = v } };
+}
+
+void
+gl_state_uniform1f(GLint location, GLfloat v)
+{
+	struct uniform *u = uniform_slot(location);
+	gboolean known = shadow.program != UNKNOWN && shadow.program != 0 && location >= 0;
+
+	/* Bitwise, so that -0 and NaN go through. */
+	if (redundant(known && u->program == shadow.program && u->location == location &&
+		      u->is_float && memcmp(&u->v.f, &v, sizeof(v)) == 0))
+		return;
+	glUniform1f(location, v);
+	if (known)
+		*u = (struct uniform){ shadow.program, location, TRUE, { .f = v } };
+}
+
+void
+gl_state_active_texture(GLenum unit)
+{
+	if (redundant(shadow.unit == unit))
+		return;
+	glActiveTexture(unit);
+	shadow.unit = unit;
+}
+
+void
+gl_state_bind_texture(GLenum target, GLuint texture)
+{
+	GLuint *bound = NULL;
+	unsigned int unit = shadow.unit - GL_TEXTURE0;
+
+	if (shadow.unit && unit < GL_STATE_UNITS) {
+		if (target == GL_TEXTURE_2D)
+			bound = &shadow.textures[unit][0];
+		else if (target == GL_TEXTURE_2D_ARRAY)
+			bound = &shadow.textures[unit][1];
+	}
+	if (redundant(bound && *bound == texture))
+		return;
+	glBindTexture(target, texture);
+	if (bound)
+		*bound = texture;
+}
+
+void
+gl_state_forget_texture(GLuint texture)
+{
+	int i, j;
+
+	for (i = 0; i < GL_STATE_UNITS; i++)
+		for (j = 0; j < 2; j++)
+			if (shadow.textures[i][j] == texture)
+				shadow.textures[i][j] = UNKNOWN;
+}
+
+GLuint
+gl_state_framebuffer(void)
+{
+	GLint framebuffer;
+
+	if (enabled && shadow.framebuffer != UNKNOWN)
+		return shadow.framebuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+	if (enabled)
+		shadow.framebuffer = framebuffer;
+	return framebuffer;
+}
+
+void
+gl_state_bind_framebuffer(GLuint framebuffer)
+{
+	if (redundant(shadow.framebuffer == framebuffer))
+		return;
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	shadow.framebuffer = framebuffer;
+}
+
+/* Deleting the bound framebuffer binds 0. */
+void
+gl_state_forget_framebuffer(GLuint framebuffer)
+{
+	if (shadow.framebuffer == framebuffer)
+		shadow.framebuffer = 0;
+}
+
+void
+gl_state_get_viewport(GLint *viewport)
+{
+	if (enabled && shadow.viewport_known) {
+		memcpy(viewport, shadow.viewport, sizeof(shadow.viewport));
+		return;
+	}
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (enabled) {
+		memcpy(shadow.viewport, viewport, sizeof(shadow.viewport));
+		shadow.viewport_known = TRUE;
+	}
+}
+
+void
+gl_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	GLint v[4] = { x, y, width, height };
+
+	if (redundant(shadow.viewport_known && memcmp(shadow.viewport, v, sizeof(v)) == 0))
+		return;
+	glViewport(x, y, width, height);
+	memcpy(shadow.viewport, v, sizeof(v));
+	shadow.viewport_known = TRUE;
+}
+
+void
+gl_state_clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+	GLfloat c[4] = { r, g, b, a };
+
+	if (redundant(shadow.clear_known && memcmp(shadow.clear, c, sizeof(c)) == 0))
+		return;
+	glClearColor(r, g, b, a);
+	memcpy(shadow.clear, c, sizeof(c));
+	shadow.clear_known = TRUE;
+}
+
+GLuint
+gl_state_vertex_array(void)
+{
+	GLint vao;
+
+	if (enabled && shadow.vao != UNKNOWN)
+		return shadow.vao;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+	if (enabled)
+		shadow.vao = vao;
+	return vao;
+}
+
+void
+gl_state_bind_vertex_array(GLuint vao)
+{
+	if (redundant(shadow.vao == vao))
+		return;
+	glBindVertexArray(vao);
+	shadow.vao = vao;
+}
+
+/* Asks GL once after an invalidate, not at all while disabled. */
+static gboolean
+on_vertex_array_0(void)
+{
+	return enabled && gl_state_vertex_array() == 0;
+}
+
+void
+gl_state_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+			GLsizei stride, const void *pointer)
+{
+	struct attrib_pointer *p = index < GL_STATE_ATTRIBS && on_vertex_array_0() ?
+		&shadow.pointers[index] : NULL;
+	struct attrib_pointer want = { TRUE, size, type, normalized, stride, pointer };
+
+	if (redundant(p && p->known && p->size == size && p->type == type &&
+		      p->normalized == normalized && p->stride == stride && p->pointer == pointer))
+		return;
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	if (p)
+		*p = want;
+}
+
+/* Bit of index in vertex array 0's masks, 0 when not tracked. */
+static unsigned int
+attrib_bit(GLuint index)
+{
+	return index < GL_STATE_ATTRIBS && on_vertex_array_0() ? 1u << index : 0;
+}
+
+void
+gl_state_enable_attrib(GLuint index)
+{
+	unsigned int bit = attrib_bit(index);
+
+	if (redundant(shadow.attribs_known & shadow.attribs_on & bit))
+		return;
+	glEnableVertexAttribArray(index);
+	shadow.attribs_known |= bit;
+	shadow.attribs_on |= bit;
+}
+
+void
+gl_state_disable_attrib(GLuint index)
+{
+	unsigned int bit = attrib_bit(index);
+
+	if (redundant(shadow.attribs_known & ~shadow.attribs_on & bit))
+		return;
+	glDisableVertexAttribArray(index);
+	shadow.attribs_known |= bit;
+	shadow.attribs_on &= ~bit;
+}
+
+void
+gl_state_frame(void)
+{
+	gint64 now = g_get_monotonic_time();
+	unsigned int total;
+
+	stats.frames++;
+	if (!stats.since)
+		stats.since = now;
+	if (now - stats.since >= G_USEC_PER_SEC) {
+		total = stats.issued + stats.elided;
+		printf("glstate: %.1f calls issued, %.1f elided per frame (%.0f%%)%s, %u frames\n",
+		       (double)stats.issued / stats.frames, (double)stats.elided / stats.frames,
+		       total ? 100.0 * stats.elided / total : 0.0, enabled ? "" : ", cache off",
+		       stats.frames);
+		memset(&stats, 0, sizeof(stats));
+		stats.since = now;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+/*
+ * GL state tracker: shadows the current program, active texture unit,
+ * 2D and 2D array bindings of units 0 to GL_STATE_UNITS - 1, the
+ * framebuffer binding, viewport,
+ * clear color, int and float uniforms of each program, and the enabled
+ * vertex attributes and client array pointers of vertex array 0, and
+ * drops calls that would set what is already set. Until
+ * gl_state_enable() every call goes straight to GL, so code that mixes
+ * these with plain GL calls keeps working; once enabled, every change to
+ * the tracked state must go through here or be followed by
+ * gl_state_invalidate(). Programs are assumed never to be deleted, as
+ * program_get() keeps them; deleted textures and framebuffers are
+ * forgotten with gl_state_forget_texture() and
+ * gl_state_forget_framebuffer().
+ */
+#define GL_STATE_UNITS 8
+#define GL_STATE_ATTRIBS 8
+
+void gl_state_enable(gboolean enable);
+/* Forget everything, the next call of each kind goes to GL. */
+void gl_state_invalidate(void);
+
+/* The current program, from the shadow when it is known. */
+GLuint gl_state_program(void);
+void gl_state_use_program(GLuint program);
+void gl_state_uniform1i(GLint location, GLint v);
+void gl_state_uniform1f(GLint location, GLfloat v);
+
+void gl_state_active_texture(GLenum unit);
+void gl_state_bind_texture(GLenum target, GLuint texture);
+void gl_state_forget_texture(GLuint texture);
+
+/* The current framebuffer, from the shadow when it is known. */
+GLuint gl_state_framebuffer(void);
+void gl_state_bind_framebuffer(GLuint framebuffer);
+void gl_state_forget_framebuffer(GLuint framebuffer);
+
+/* The current viewport, from the shadow when it is known. */
+void gl_state_get_viewport(GLint *viewport);
+void gl_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void gl_state_clear_color(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+
+/* The current vertex array, from the shadow when it is known. */
+GLuint gl_state_vertex_array(void);
+void gl_state_bind_vertex_array(GLuint vao);
+/* Vertex array 0 only, with no array buffer bound: pointer is client memory. */
+void gl_state_attrib_pointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+			     GLsizei stride, const void *pointer);
+void gl_state_enable_attrib(GLuint index);
+void gl_state_disable_attrib(GLuint index);
+
+/*
+ * Call once per frame: prints the calls issued and elided per frame
+ * every second.
+ */
+void gl_state_frame(void);
+
+#endif
@@ -1,31 +1,30 @@
+#include <stdio.h>
+
 #include <gtk/gtk.h>
-#include <gdk/gdkx.h>
-#include <EGL/egl.h>
 #include <GL/gl.h>
 
-static EGLDisplay *egl_display;
-static EGLSurface *egl_surface;
-static EGLContext *egl_context;
+#include "context.h"
+#include "frameloop.h"
+#include "tribench.h"
+
+static struct render_ctx ctx;
+static struct frame_loop loop;
+static int triangles;	/* benchmark mode when > 0 */
+static struct tri_bench bench;
+static float *bench_xy, *bench_rgb;
+
+static GOptionEntry entries[] = {
+    { "triangles", 'n', 0, G_OPTION_ARG_INT, &triangles, "Benchmark: draw N triangles per frame, up to 1000000, as fast as possible", "N" },
+    { NULL }
+};
 
 static void realize_cb (GtkWidget *widget)
 {
-    EGLConfig egl_config;
-    EGLint n_config;
-    EGLint attributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
-                            EGL_NONE };
-
-    egl_display = eglGetDisplay ((EGLNativeDisplayType) gdk_x11_display_get_xdisplay (gtk_widget_get_display (widget)));
-    eglInitialize (egl_display, NULL, NULL);
-    eglChooseConfig (egl_display, attributes, &egl_config, 1, &n_config);
-    eglBindAPI (EGL_OPENGL_API);
-    egl_surface = eglCreateWindowSurface (egl_display, egl_config, gdk_x11_window_get_xid (gtk_widget_get_window (widget)), NULL);
-    egl_context = eglCreateContext (egl_display, egl_config, EGL_NO_CONTEXT, NULL);
+    render_ctx_init (&ctx, widget, RENDER_API_GL);
 }
 
 static gboolean draw_cb (GtkWidget *widget)
 {
-    eglMakeCurrent (egl_display, egl_surface, egl_surface, egl_context);
-
     glViewport (0, 0, gtk_widget_get_allocated_width (widget), gtk_widget_get_allocated_height (widget));
 
     glClearColor (0, 0, 0, 1);
@@ -35,6 +34,26 @@ static gboolean draw_cb (GtkWidget *widget)
     glLoadIdentity ();
     glOrtho (0, 100, 0, 100, 0, 1);
 
+    if (triangles) {
+        int i;
+
+        /* One call per attribute per vertex, as legacy code does it. */
+        tri_bench_begin (&bench);
+        glBegin (GL_TRIANGLES);
+        for (i = 0; i < 3 * triangles; i++) {
+            glColor3fv (&bench_rgb[i * 3]);
+            glVertex2fv (&bench_xy[i * 2]);
+        }
+        glEnd ();
+        tri_bench_submitted (&bench);
+        glFinish ();
+        tri_bench_end (&bench);
+
+        render_ctx_swap (&ctx);
+        frame_loop_drawn (&loop);
+        return TRUE;
+    }
+
     glBegin (GL_TRIANGLES);
     glColor3f (1, 0, 0);
     glVertex2f (50, 10);
@@ -44,25 +63,38 @@ static gboolean draw_cb (GtkWidget *widget)
     glVertex2f (10, 90);
     glEnd ();
 
-    eglSwapBuffers (egl_display, egl_surface);
+    render_ctx_swap (&ctx);
+    frame_loop_drawn (&loop);
 
     return TRUE;
 }
 
-int main (int argc, char **argv)
+/* Benchmark tick: every tick is a new frame, the draws set the pace. */
+static gboolean bench_tick (gpointer data)
 {
-    GtkWidget *w;
-
-    gtk_init (&argc, &argv);
-
-    w = gtk_window_new (GTK_WINDOW_TOPLEVEL);
-    gtk_widget_set_double_buffered (GTK_WIDGET (w), FALSE);
-    g_signal_connect (G_OBJECT (w), "realize", G_CALLBACK (realize_cb), NULL);
-    g_signal_connect (G_OBJECT (w), "draw", G_CALLBACK (draw_cb), NULL);
-
-    gtk_widget_show (w);
+    (void) data;
+    return TRUE;
+}
 
-    gtk_main ();
+int main (int argc, char **argv)
+{
+    if (!frame_loop_parse_args (&argc, &argv, entries))
+        return 1;
+    if (triangles < 0 || triangles > TRI_BENCH_MAX_TRIANGLES) {
+        fprintf (stderr, "Error: bad number of triangles %d\n", triangles);
+        return 1;
+    }
+
+    if (triangles) {
+        bench_xy = g_new (float, 6 * triangles);
+        bench_rgb = g_new (float, 9 * triangles);
+        tri_bench_layout (triangles, bench_xy, bench_rgb);
+        tri_bench_init (&bench, "immediate", triangles);
+        loop.interval = 1;
+        loop.tick = bench_tick;
+    }
+
+    frame_loop_run (&loop, G_CALLBACK (realize_cb), G_CALLBACK (draw_cb));
 
     return 0;
 }
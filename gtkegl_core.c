@@ -0,0 +1,150 @@
+/*
+ * The gtkegl triangle on a desktop OpenGL 3.3 core profile context:
+ * vertices in a buffer object behind a vertex array, a GLSL 330
+ * program, one glDrawArrays. Drivers that have no compatibility profile
+ * still run it, and --triangles N draws the same benchmark grid as
+ * gtkegl, to put a number on the immediate mode overhead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <gtk/gtk.h>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+
+#include "context.h"
+#include "frameloop.h"
+#include "program.h"
+#include "tribench.h"
+
+static struct render_ctx ctx;
+static struct frame_loop loop;
+static int triangles;	/* benchmark mode when > 0 */
+static gboolean stream;	/* upload the vertices every frame */
+static struct tri_bench bench;
+static float *xy, *rgb;
+struct {
+	GLuint vao, vbo;
+	int count;	/* triangles in the buffer */
+} gl;
+
+static GOptionEntry entries[] = {
+	{ "triangles", 'n', 0, G_OPTION_ARG_INT, &triangles, "Benchmark: draw N triangles per frame, up to 1000000, as fast as possible", "N" },
+	{ "stream", 0, 0, G_OPTION_ARG_NONE, &stream, "Upload the vertices again every frame, as immediate mode does", NULL },
+	{ NULL }
+};
+
+/* The 0..100 square of gtkegl's glOrtho onto the viewport. */
+static const char *vert_shader_text =
+	"#version 330 core\n"
+	"layout(location = 0) in vec2 pos;\n"
+	"layout(location = 1) in vec3 color;\n"
+	"out vec3 v_color;\n"
+	"void main() {\n"
+	"  gl_Position = vec4(pos / 50.0 - 1.0, 0.0, 1.0);\n"
+	"  v_color = color;\n"
+	"}\n";
+
+static const char *frag_shader_text =
+	"#version 330 core\n"
+	"in vec3 v_color;\n"
+	"out vec4 frag_color;\n"
+	"void main() {\n"
+	"  frag_color = vec4(v_color, 1.0);\n"
+	"}\n";
+
+static void
+init_gl(void)
+{
+	glUseProgram(program_get(vert_shader_text, frag_shader_text, NULL));
+
+	/* Positions, then colors, in one buffer. */
+	gl.count = triangles ? triangles : 1;
+	xy = g_new(float, 6 * gl.count);
+	rgb = g_new(float, 9 * gl.count);
+	tri_bench_layout(gl.count, xy, rgb);
+
+	glGenVertexArrays(1, &gl.vao);
+	glBindVertexArray(gl.vao);
+	glGenBuffers(1, &gl.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, gl.vbo);
+	glBufferData(GL_ARRAY_BUFFER, 15 * sizeof(float) * gl.count, NULL,
+		     stream ? GL_STREAM_DRAW : GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, 6 * sizeof(float) * gl.count, xy);
+	glBufferSubData(GL_ARRAY_BUFFER, 6 * sizeof(float) * gl.count,
+			9 * sizeof(float) * gl.count, rgb);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0,
+			      (void *)(6 * sizeof(float) * gl.count));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+
+	if (glGetError() != GL_NO_ERROR) {
+		fprintf(stderr, "Error: setting up the vertex array failed\n");
+		exit(1);
+	}
+}
+
+static void realize_cb (GtkWidget *widget)
+{
+	render_ctx_init(&ctx, widget, RENDER_API_GL_CORE);
+
+	init_gl();
+}
+
+static gboolean draw_cb (GtkWidget *widget)
+{
+	glViewport (0, 0, gtk_widget_get_allocated_width (widget), gtk_widget_get_allocated_height (widget));
+
+	glClearColor(0, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if (triangles)
+		tri_bench_begin(&bench);
+
+	/* Orphaned and filled again, the core profile's closest thing to glBegin. */
+	if (stream) {
+		glBufferData(GL_ARRAY_BUFFER, 15 * sizeof(float) * gl.count, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, 6 * sizeof(float) * gl.count, xy);
+		glBufferSubData(GL_ARRAY_BUFFER, 6 * sizeof(float) * gl.count,
+				9 * sizeof(float) * gl.count, rgb);
+	}
+	glDrawArrays(GL_TRIANGLES, 0, 3 * gl.count);
+
+	if (triangles) {
+		tri_bench_submitted(&bench);
+		glFinish();
+		tri_bench_end(&bench);
+	}
+
+	render_ctx_swap(&ctx);
+	frame_loop_drawn(&loop);
+
+	return TRUE;
+}
+
+/* Benchmark tick: every tick is a new frame, the draws set the pace. */
+static gboolean bench_tick(gpointer data)
+{
+	(void)data;
+	return TRUE;
+}
+
+int main (int argc, char **argv)
+{
+	if (!frame_loop_parse_args(&argc, &argv, entries))
+		return 1;
+	if (triangles < 0 || triangles > TRI_BENCH_MAX_TRIANGLES) {
+		fprintf(stderr, "Error: bad number of triangles %d\n", triangles);
+		return 1;
+	}
+
+	if (triangles) {
+		tri_bench_init(&bench, stream ? "core, streamed" : "core, static", triangles);
+		loop.interval = 1;
+		loop.tick = bench_tick;
+	}
+	frame_loop_run(&loop, G_CALLBACK(realize_cb), G_CALLBACK(draw_cb));
+
+	return 0;
+}
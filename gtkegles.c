@@ -1,223 +1,394 @@
 #include <assert.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/time.h>
 
 #include <gtk/gtk.h>
-#include <gdk/gdkx.h>
-#include <GLES2/gl2.h>
-#include <EGL/egl.h>
-
-static EGLDisplay *egl_display;
-static EGLSurface *egl_surface;
-static EGLContext *egl_context;
+#include <GLES3/gl3.h>
+
+#include "context.h"
+#include "frameloop.h"
+#include "program.h"
+#include "vecmath.h"
+
+/*
+ * Rotating triangles, 1 by default, up to STRESS_MAX_TRIANGLES in a grid
+ * as a geometry stress test, each a little further round than the one
+ * before. --method picks how they reach the GPU:
+ *
+ *   uniform    a rotation uniform and a draw per triangle
+ *   batch      the CPU transforms every vertex into one dynamic VBO, one draw
+ *   instanced  the CPU builds a matrix per triangle into an instance VBO,
+ *              one instanced draw
+ *   feedback   a transform feedback pass builds the matrices on the GPU
+ *              from static instance data, then the same instanced draw
+ */
+#define STRESS_MAX_TRIANGLES 1000000
+#define STRESS_PHASE 0.05f	/* radians between neighbours */
+
+enum stress_method {
+	STRESS_UNIFORM,
+	STRESS_BATCH,
+	STRESS_INSTANCED,
+	STRESS_FEEDBACK,
+};
+
+static const char *const method_names[] = {
+	"uniform", "batch", "instanced", "feedback",
+};
+
+static struct render_ctx ctx;
+static struct frame_loop loop;
+static int triangles = 1;
+static char *method_name;
+static enum stress_method method;
 struct {
+	GLuint program;
 	GLuint rotation_uniform;
-	GLuint pos;
-	GLuint col;
+	GLuint vao, verts, colors, models;
+	struct vm_instance *layout;
+	float *cpu;		/* vertices or matrices built each frame */
+
+	GLuint feedback_program, feedback_vao, feedback, instances;
+	GLint feedback_angle;
 } gl;
 unsigned int angle = 0;
 
+static struct {
+	unsigned int frames, draws;
+	gint64 cpu;		/* us building and issuing */
+	gint64 since;
+} stats;
+
+static GOptionEntry entries[] = {
+	{ "triangles", 'n', 0, G_OPTION_ARG_INT, &triangles, "Number of rotating triangles, up to 1000000", "N" },
+	{ "method", 0, 0, G_OPTION_ARG_STRING, &method_name, "How they are drawn: uniform, batch, instanced or feedback", "NAME" },
+	{ NULL }
+};
+
+static const GLfloat verts[3][2] = {
+	{ -0.5, -0.5 },
+	{  0.5, -0.5 },
+	{  0,    0.5 }
+};
+
+static const GLfloat colors[3][3] = {
+	{ 1, 0, 0 },
+	{ 0, 1, 0 },
+	{ 0, 0, 1 }
+};
+
+/* model is the identity, unless the instanced methods feed it. */
 static const char *vert_shader_text =
+	"#version 300 es\n"
 	"uniform mat4 rotation;\n"
-	"attribute vec4 pos;\n"
-	"attribute vec4 color;\n"
-	"varying vec4 v_color;\n"
+	"layout(location = 0) in vec4 pos;\n"
+	"layout(location = 1) in vec4 color;\n"
+	"layout(location = 2) in mat4 model;\n"
+	"out vec4 v_color;\n"
 	"void main() {\n"
-	"  gl_Position = rotation * pos;\n"
+	"  gl_Position = rotation * model * pos;\n"
 	"  v_color = color;\n"
 	"}\n";
 
 static const char *frag_shader_text =
+	"#version 300 es\n"
+	"precision mediump float;\n"
+	"in vec4 v_color;\n"
+	"out vec4 frag_color;\n"
+	"void main() {\n"
+	"  frag_color = v_color;\n"
+	"}\n";
+
+/* The columns of vm_model_matrices(), one point per triangle, captured. */
+static const char *feedback_vert_shader_text =
+	"#version 300 es\n"
+	"uniform float angle;\n"
+	"layout(location = 0) in vec4 instance;\n"
+	"out vec4 col0, col1, col2, col3;\n"
+	"void main() {\n"
+	"  float a = angle + instance.w;\n"
+	"  float c = cos(a) * instance.z, s = sin(a) * instance.z;\n"
+	"  col0 = vec4(c, 0.0, s, 0.0);\n"
+	"  col1 = vec4(0.0, instance.z, 0.0, 0.0);\n"
+	"  col2 = vec4(-s, 0.0, c, 0.0);\n"
+	"  col3 = vec4(instance.xy, 0.0, 1.0);\n"
+	"}\n";
+
+static const char *feedback_frag_shader_text =
+	"#version 300 es\n"
 	"precision mediump float;\n"
-	"varying vec4 v_color;\n"
+	"out vec4 frag_color;\n"
 	"void main() {\n"
-	"  gl_FragColor = v_color;\n"
+	"  frag_color = vec4(0.0);\n"
 	"}\n";
 
-GLenum glCheckError_(const char *file, int line)
+/*
+ * Triangle i fills its grid cell and turns STRESS_PHASE further than the
+ * one before, the phase kept within a turn for the fast sine and cosine.
+ * A single triangle is the plain rotation.
+ */
+static void
+init_layout(void)
 {
-    GLenum errorCode;
-    while ((errorCode = glGetError()) != GL_NO_ERROR) {
-	printf("%d | %s:%d\n", errorCode, file, line);
-    }
-    return errorCode;
+	int cols = ceil(sqrt(triangles));
+	float cell = 2.0f / cols;
+	int i;
+
+	gl.layout = g_new(struct vm_instance, triangles);
+	for (i = 0; i < triangles; i++) {
+		struct vm_instance *l = &gl.layout[i];
+
+		l->x = triangles > 1 ? -1 + (i % cols + 0.5f) * cell : 0;
+		l->y = triangles > 1 ? 1 - (i / cols + 0.5f) * cell : 0;
+		l->scale = triangles > 1 ? cell : 1;
+		l->phase = fmodf(i * STRESS_PHASE, 2 * M_PI);
+	}
 }
-#define glCheckError() glCheckError_(__FILE__, __LINE__)
 
-static GLuint
-create_shader(const char *source, GLenum shader_type)
+/* Matrix columns at locations 2 to 5 from the bound buffer, one per instance. */
+static void
+model_attribs(void)
 {
-	GLuint shader;
-	GLint status;
-
-	shader = glCreateShader(shader_type);
-	glCheckError();
+	int i;
 
-	glShaderSource(shader, 1, (const char **) &source, NULL);
-	glCheckError();
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char log[1000];
-		GLsizei len;
-		glGetShaderInfoLog(shader, 1000, &len, log);
-		fprintf(stderr, "Error: compiling %s: %.*s\n",
-			shader_type == GL_VERTEX_SHADER ? "vertex" : "fragment",
-			len, log);
-		exit(1);
+	for (i = 0; i < 4; i++) {
+		glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, 16 * sizeof(float),
+				      (void *)(i * 4 * sizeof(float)));
+		glVertexAttribDivisor(2 + i, 1);
+		glEnableVertexAttribArray(2 + i);
 	}
-
-	return shader;
 }
 
 static void
-init_gl(void)
+init_feedback(void)
 {
-	GLuint frag, vert;
+	static const char *const varyings[] = { "col0", "col1", "col2", "col3", NULL };
 	GLuint program;
-	GLint status;
-
-	frag = create_shader(frag_shader_text, GL_FRAGMENT_SHADER);
-	vert = create_shader(vert_shader_text, GL_VERTEX_SHADER);
-
-	program = glCreateProgram();
-	glAttachShader(program, frag);
-	glAttachShader(program, vert);
-	glLinkProgram(program);
-
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (!status) {
-		char log[1000];
-		GLsizei len;
-		glGetProgramInfoLog(program, 1000, &len, log);
-		fprintf(stderr, "Error: linking:\n%.*s\n", len, log);
-		exit(1);
-	}
-
-	glUseProgram(program);
 
-	gl.pos = 0;
-	gl.col = 1;
-
-	glBindAttribLocation(program, gl.pos, "pos");
-	glBindAttribLocation(program, gl.col, "color");
-	glLinkProgram(program);
-
-	gl.rotation_uniform = glGetUniformLocation(program, "rotation");
+	program = program_get_feedback(feedback_vert_shader_text, feedback_frag_shader_text,
+				       NULL, varyings);
+	gl.feedback_program = program;
+	gl.feedback_angle = glGetUniformLocation(program, "angle");
+
+	/* Static per instance input, read once per frame by the pass. */
+	glGenVertexArrays(1, &gl.feedback_vao);
+	glBindVertexArray(gl.feedback_vao);
+	glGenBuffers(1, &gl.instances);
+	glBindBuffer(GL_ARRAY_BUFFER, gl.instances);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(*gl.layout) * triangles, gl.layout, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	glGenTransformFeedbacks(1, &gl.feedback);
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, gl.feedback);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gl.models);
+	glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
 }
 
-static void realize_cb (GtkWidget *widget)
+static void
+init_gl(void)
 {
-	static const EGLint context_attribs[] = {
-		EGL_CONTEXT_MAJOR_VERSION, 3,
-		EGL_NONE
-	};
-	EGLint attributes[] = {
-		EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-		EGL_RED_SIZE, 1,
-		EGL_GREEN_SIZE, 1,
-		EGL_BLUE_SIZE, 1,
-		EGL_ALPHA_SIZE, 1,
-		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-		EGL_NONE
+	static const GLfloat identity[4][4] = {
+		{ 1, 0, 0, 0 },
+		{ 0, 1, 0, 0 },
+		{ 0, 0, 1, 0 },
+		{ 0, 0, 0, 1 }
 	};
+	GLfloat *c;
+	int i;
+
+	gl.program = program_get(vert_shader_text, frag_shader_text, NULL);
+	glUseProgram(gl.program);
+	gl.rotation_uniform = glGetUniformLocation(gl.program, "rotation");
+	glUniformMatrix4fv(gl.rotation_uniform, 1, GL_FALSE, (GLfloat *)identity);
+
+	init_layout();
+
+	glGenVertexArrays(1, &gl.vao);
+	glBindVertexArray(gl.vao);
+
+	/* A color per vertex of every triangle, for the batch; the rest use the first three. */
+	c = g_new(GLfloat, 9 * triangles);
+	for (i = 0; i < triangles; i++)
+		memcpy(&c[i * 9], colors, sizeof(colors));
+	glGenBuffers(1, &gl.colors);
+	glBindBuffer(GL_ARRAY_BUFFER, gl.colors);
+	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat) * triangles, c, GL_STATIC_DRAW);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(1);
+	g_free(c);
+
+	glGenBuffers(1, &gl.verts);
+	glBindBuffer(GL_ARRAY_BUFFER, gl.verts);
+	if (method == STRESS_BATCH) {
+		gl.cpu = g_new(float, 9 * triangles);
+		glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(float) * triangles, NULL, GL_STREAM_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	} else {
+		glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+	glEnableVertexAttribArray(0);
+
+	/* Without an array the model attribute stays at the identity. */
+	for (i = 0; i < 4; i++)
+		glVertexAttrib4fv(2 + i, identity[i]);
+
+	if (method == STRESS_INSTANCED || method == STRESS_FEEDBACK) {
+		glGenBuffers(1, &gl.models);
+		glBindBuffer(GL_ARRAY_BUFFER, gl.models);
+		/* Written by transform feedback and only read by the draw in that mode. */
+		glBufferData(GL_ARRAY_BUFFER, 16 * sizeof(float) * triangles, NULL,
+			     method == STRESS_FEEDBACK ? GL_STREAM_COPY : GL_STREAM_DRAW);
+		model_attribs();
+		if (method == STRESS_INSTANCED)
+			gl.cpu = g_new(float, 16 * triangles);
+		else
+			init_feedback();
+		glBindVertexArray(gl.vao);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glCheckError();
+}
 
-	EGLConfig egl_config;
-	EGLint major, minor, n_config;
-	EGLBoolean ret;
-
-	egl_display = eglGetDisplay((EGLNativeDisplayType) gdk_x11_display_get_xdisplay (gtk_widget_get_display (widget)));
-
-	ret = eglInitialize(egl_display, &major, &minor);
-	assert(ret == EGL_TRUE);
-
-	ret = eglBindAPI(EGL_OPENGL_ES_API);
-	assert(ret == EGL_TRUE);
-
-	eglChooseConfig(egl_display, attributes, &egl_config, 1, &n_config);
-	egl_surface = eglCreateWindowSurface(egl_display, egl_config, gdk_x11_window_get_xid (gtk_widget_get_window (widget)), NULL);
-	assert(egl_surface);
+static void realize_cb (GtkWidget *widget)
+{
+	render_ctx_init(&ctx, widget, RENDER_API_GLES);
 
-	egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
-	assert(egl_context);
+	init_gl();
+}
 
-	ret = eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
-	assert(ret == EGL_TRUE);
+/* Issue the frame's triangles, returns the number of draw calls. */
+static unsigned int
+draw_triangles(float a)
+{
+	GLfloat m[16];
+	int i;
+
+	switch (method) {
+	case STRESS_UNIFORM:
+		for (i = 0; i < triangles; i++) {
+			vm_model_matrices(&gl.layout[i], 1, a, m);
+			glUniformMatrix4fv(gl.rotation_uniform, 1, GL_FALSE, m);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		return triangles;
+
+	case STRESS_BATCH:
+		vm_model_vertices(gl.layout, triangles, a, &verts[0][0], 3, gl.cpu);
+		/* Orphan last frame's storage rather than wait for the draw still reading it. */
+		glBindBuffer(GL_ARRAY_BUFFER, gl.verts);
+		glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(float) * triangles, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, 9 * sizeof(float) * triangles, gl.cpu);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDrawArrays(GL_TRIANGLES, 0, 3 * triangles);
+		return 1;
+
+	case STRESS_INSTANCED:
+		vm_model_matrices(gl.layout, triangles, a, gl.cpu);
+		glBindBuffer(GL_ARRAY_BUFFER, gl.models);
+		glBufferData(GL_ARRAY_BUFFER, 16 * sizeof(float) * triangles, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, 16 * sizeof(float) * triangles, gl.cpu);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 3, triangles);
+		return 1;
+
+	case STRESS_FEEDBACK:
+		glUseProgram(gl.feedback_program);
+		glUniform1f(gl.feedback_angle, a);
+		glBindVertexArray(gl.feedback_vao);
+		glEnable(GL_RASTERIZER_DISCARD);
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, gl.feedback);
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, triangles);
+		glEndTransformFeedback();
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+		glDisable(GL_RASTERIZER_DISCARD);
+
+		glUseProgram(gl.program);
+		glBindVertexArray(gl.vao);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, 3, triangles);
+		return 2;
+	}
 
-	init_gl();
+	return 0;
 }
 
 static gboolean draw_cb (GtkWidget *widget)
 {
-	static const GLfloat verts[3][2] = {
-		{ -0.5, -0.5 },
-		{  0.5, -0.5 },
-		{  0,    0.5 }
-	};
-	static const GLfloat colors[3][3] = {
-		{ 1, 0, 0 },
-		{ 0, 1, 0 },
-		{ 0, 0, 1 }
-	};
-	GLfloat _angle;
-	GLfloat rotation[4][4] = {
-		{ 1, 0, 0, 0 },
-		{ 0, 1, 0, 0 },
-		{ 0, 0, 1, 0 },
-		{ 0, 0, 0, 1 }
-	};
-
-	angle += 5;
-	_angle = angle % 360 * M_PI / 180.0;
-	rotation[0][0] =  cos(_angle);
-	rotation[0][2] =  sin(_angle);
-	rotation[2][0] = -sin(_angle);
-	rotation[2][2] =  cos(_angle);
+	gint64 start = g_get_monotonic_time(), now;
 
 	glViewport (0, 0, gtk_widget_get_allocated_width (widget), gtk_widget_get_allocated_height (widget));
-	glUniformMatrix4fv(gl.rotation_uniform, 1, GL_FALSE, (GLfloat *) rotation);
 	glClearColor(0.0, 0.0, 0.0, 0.5);
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	glVertexAttribPointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, verts);
-	glVertexAttribPointer(gl.col, 3, GL_FLOAT, GL_FALSE, 0, colors);
-	glEnableVertexAttribArray(gl.pos);
-	glEnableVertexAttribArray(gl.col);
-
-	glDrawArrays(GL_TRIANGLES, 0, 3);
-
-	glDisableVertexAttribArray(gl.pos);
-	glDisableVertexAttribArray(gl.col);
-
-	eglSwapBuffers (egl_display, egl_surface);
+	stats.draws += draw_triangles(angle % 360 * M_PI / 180.0);
+	stats.cpu += g_get_monotonic_time() - start;
+
+	render_ctx_swap(&ctx);
+	frame_loop_drawn(&loop);
+
+	if (triangles == 1)
+		return TRUE;
+
+	now = g_get_monotonic_time();
+	stats.frames++;
+	if (!stats.since)
+		stats.since = now;
+	if (now - stats.since >= G_USEC_PER_SEC) {
+		double s = (now - stats.since) / (double)G_USEC_PER_SEC;
+
+		printf("stress: %s, %d triangles, %u draws per frame, %.1f fps, %.0f draws/s, "
+		       "%.2f Mvertices/s, %.3f ms CPU per frame\n", method_names[method],
+		       triangles, stats.draws / stats.frames, stats.frames / s, stats.draws / s,
+		       3.0 * triangles * stats.frames / s / 1e6,
+		       stats.cpu / 1000.0 / stats.frames);
+		memset(&stats, 0, sizeof(stats));
+		stats.since = now;
+	}
 
 	return TRUE;
 }
 
-static gboolean redraw(GtkWidget *widget)
+/* Animation tick: advance the triangles, every tick is a new frame. */
+static gboolean tick(gpointer data)
 {
-	gtk_widget_queue_draw(widget);
+	(void)data;
+	angle += 5;
 
 	return TRUE;
 }
 
 int main (int argc, char **argv)
 {
-	GtkWidget *w;
+	unsigned int i;
 
-	gtk_init(&argc, &argv);
-
-	w = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-	gtk_widget_set_double_buffered(GTK_WIDGET(w), FALSE);
-	g_signal_connect(G_OBJECT(w), "realize", G_CALLBACK(realize_cb), NULL);
-	g_signal_connect(G_OBJECT(w), "draw", G_CALLBACK(draw_cb), NULL);
-	g_timeout_add(34, (GSourceFunc) redraw, w);
-
-	gtk_widget_show(w);
+	if (!frame_loop_parse_args(&argc, &argv, entries))
+		return 1;
+	if (triangles < 1 || triangles > STRESS_MAX_TRIANGLES) {
+		fprintf(stderr, "Error: bad number of triangles %d\n", triangles);
+		return 1;
+	}
+	if (method_name) {
+		for (i = 0; i < G_N_ELEMENTS(method_names); i++)
+			if (!strcmp(method_name, method_names[i]))
+				break;
+		if (i == G_N_ELEMENTS(method_names)) {
+			fprintf(stderr, "Error: unknown method '%s', try uniform, batch, "
+				"instanced or feedback\n", method_name);
+			return 1;
+		}
+		method = i;
+	}
 
-	gtk_main();
+	/* A stress test runs as fast as the draws let it. */
+	loop.interval = triangles > 1 ? 1 : 34;
+	loop.tick = tick;
+	frame_loop_run(&loop, G_CALLBACK(realize_cb), G_CALLBACK(draw_cb));
 
 	return 0;
 }
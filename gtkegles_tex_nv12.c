@@ -1,33 +1,84 @@
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include <gtk/gtk.h>
-#include <gdk/gdkx.h>
 #include <GLES3/gl3.h>
-#include <EGL/egl.h>
+
+#include "context.h"
+#include "downscale.h"
+#include "frameloop.h"
+#include "font.h"
+#include "framesource.h"
+#include "glstate.h"
+#include "hud.h"
+#include "overlay.h"
+#include "present.h"
+#include "program.h"
+#include "scaler.h"
+#include "texpool.h"
+#include "texstream.h"
+#include "yuvshader.h"
 
 static int width = 512;
 static int height = 512;
-static EGLDisplay *egl_display;
-static EGLSurface *egl_surface;
-static EGLContext *egl_context;
+static int stride;	/* luma pitch in bytes, defaults to width */
+static int uv_stride;	/* chroma pitch in bytes, defaults to what the format derives from stride */
+static int uv_offset;	/* first chroma plane offset in bytes, defaults to right after luma */
+static char *filename;
+static char *source_name;
+static char *format_name;
+static enum tex_format format = TEX_FORMAT_NV12;
+static char *transfer_name;
+static enum yuv_transfer transfer;	/* PQ for P010, SDR otherwise, by default */
+static double peak_nits = 1000.0;	/* HDR content peak, mapped to SDR white */
+static struct frame_source *source;
+static const uint8_t *frame;	/* latest frame from the source */
+static const uint8_t *prev;	/* the one before, diff base until frame is shown */
+static unsigned int frame_count;
+static int mosaic;	/* number of streams on the video wall, 0 for single view */
+static int tile = 64;	/* dirty tracking granularity in luma pixels */
+static int prefetch = FRAME_STORE_PREFETCH;	/* mmap source read ahead, 0 populates */
+static gboolean downscale = TRUE;	/* mosaic samples a converted mip chain */
+static char *upload_name;
+static enum tex_upload upload = TEX_UPLOAD_AUTO;
+static char *scale_name;
+static enum scale_kernel kernel = SCALE_BILINEAR;
+static char *siting_name;
+static enum chroma_siting siting = CHROMA_SITING_LEFT;
+static int osd;		/* overlay elements per frame, 0 for none */
+static gboolean osd_ticked;	/* only the overlay changed since the last draw */
+static gboolean show_hud;
+static gboolean no_state_cache;
+static struct render_ctx ctx;
+static struct frame_loop loop;
+static struct tex_stream stream;
+static struct presenter presenter;
+static struct mipchain mip;
+static struct scaler scaler;
+static struct overlay overlay;
+static struct hud hud;
 struct {
 	GLuint pos;
 	GLuint col;
 	GLuint tex;
-	GLint utexture_y;
-	GLint utexture_uv;
+	GLuint mosaic_vao;
+	int cols, rows;
+	GLint ulod;
+	float lod;
 } gl;
 
 static const char *vert_shader_text =
-	"attribute vec4 in_Position;			\n"
-	"attribute vec4 in_Color;			\n"
-	"attribute vec2 in_TexCoord;			\n"
+	"#version 300 es				\n"
+	"in vec4 in_Position;				\n"
+	"in vec4 in_Color;				\n"
+	"in vec2 in_TexCoord;				\n"
 	"						\n"
-	"varying vec4 vColor;				\n"
-	"varying vec2 vTexCoord;			\n"
+	"out vec4 vColor;				\n"
+	"out vec2 vTexCoord;				\n"
 	"						\n"
 	"void main() {					\n"
 	"  gl_Position = in_Position;			\n"
@@ -35,181 +86,318 @@ static const char *vert_shader_text =
 	"  vTexCoord = in_TexCoord;			\n"
 	"}						\n";
 
-static const char *frag_shader_text =
+/*
+ * Video wall: every stream is a layer of the Y and UV array textures and
+ * every tile is one instance, so the whole wall is a single draw call.
+ */
+static const char *mosaic_vert_shader_text =
+	"#version 300 es				\n"
+	"layout(location = 0) in vec2 in_Position;	\n"
+	"layout(location = 1) in vec4 in_Rect;		\n"
+	"layout(location = 2) in float in_Layer;	\n"
+	"						\n"
+	"out vec2 vTexCoord;				\n"
+	"flat out float vLayer;				\n"
+	"						\n"
+	"void main() {					\n"
+	"  vec2 p = mix(in_Rect.xy, in_Rect.zw, in_Position);\n"
+	"  gl_Position = vec4(p, 0.0, 1.0);		\n"
+	"  vTexCoord = in_Position;			\n"
+	"  vLayer = in_Layer;				\n"
+	"}						\n";
+
+static const char *mosaic_frag_shader_text =
+	"#version 300 es				\n"
 	"precision mediump float;			\n"
+	"precision mediump sampler2DArray;		\n"
+	"						\n"
+	"in vec2 vTexCoord;				\n"
+	"flat in float vLayer;				\n"
 	"						\n"
-	"varying vec4 vColor;				\n"
-	"varying vec2 vTexCoord;			\n"
+	"uniform sampler2DArray uTexY;			\n"
+	"uniform sampler2DArray uTexUV;			\n"
 	"						\n"
-        "uniform sampler2D uTexY;			\n"
-        "uniform sampler2D uTexUV;			\n"
+	"out vec4 fragColor;				\n"
 	"						\n"
 	"void main() {					\n"
-	"  float r, g, b, y, u, v;			\n"
-	"  y = texture2D(uTexY, vTexCoord).x;		\n"
-	"  u = texture2D(uTexUV, vTexCoord).x - 0.5;	\n"
-	"  v = texture2D(uTexUV, vTexCoord).y - 0.5;	\n"
-	"  r = y + 1.13983*v;				\n"
-	"  g = y - 0.39465*u - 0.58060*v;		\n"
-	"  b = y + 2.03211*u;				\n"
-	"  gl_FragColor = vec4(r, g, b, 1.0);		\n"
+	"  vec3 c = vec3(vTexCoord, vLayer);		\n"
+	"  float y = texture(uTexY, c).x;		\n"
+	"  vec2 uv = texture(uTexUV, c).xy - 0.5;	\n"
+	"  fragColor = vec4(y + 1.13983*uv.y,		\n"
+	"                   y - 0.39465*uv.x - 0.58060*uv.y,\n"
+	"                   y + 2.03211*uv.x, 1.0);	\n"
 	"}						\n";
 
-GLenum glCheckError_(const char *file, int line)
-{
-    GLenum errorCode;
-    while ((errorCode = glGetError()) != GL_NO_ERROR) {
-	printf("error 0x%x | %s:%d\n", errorCode, file, line);
-    }
-    return errorCode;
-}
-#define glCheckError() glCheckError_(__FILE__, __LINE__)
+/* Same wall, sampled from the RGBA mip chain at the level matching the tile size. */
+static const char *mosaic_mip_frag_shader_text =
+	"#version 300 es				\n"
+	"precision mediump float;			\n"
+	"precision mediump sampler2DArray;		\n"
+	"						\n"
+	"in vec2 vTexCoord;				\n"
+	"flat in float vLayer;				\n"
+	"						\n"
+	"uniform sampler2DArray uTex;			\n"
+	"uniform float uLod;				\n"
+	"						\n"
+	"out vec4 fragColor;				\n"
+	"						\n"
+	"void main() {					\n"
+	"  fragColor = textureLod(uTex, vec3(vTexCoord, vLayer), uLod);\n"
+	"}						\n";
 
-static GLuint
-create_shader(const char *source, GLenum shader_type)
-{
-	GLuint shader;
-	GLint status;
-
-	shader = glCreateShader(shader_type);
-	glShaderSource(shader, 1, (const char **) &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char log[1000];
-		GLsizei len;
-		glGetShaderInfoLog(shader, 1000, &len, log);
-		fprintf(stderr, "Error: compiling %s: %.*s\n",
-			shader_type == GL_VERTEX_SHADER ? "vertex" : "fragment",
-			len, log);
-		exit(1);
-	}
-
-	return shader;
-}
+static GOptionEntry entries[] = {
+	{ "width", 'W', 0, G_OPTION_ARG_INT, &width, "Frame width", "W" },
+	{ "height", 'H', 0, G_OPTION_ARG_INT, &height, "Frame height", "H" },
+	{ "stride", 's', 0, G_OPTION_ARG_INT, &stride, "Luma pitch in bytes", "BYTES" },
+	{ "uv-stride", 0, 0, G_OPTION_ARG_INT, &uv_stride, "Chroma pitch in bytes", "BYTES" },
+	{ "uv-offset", 0, 0, G_OPTION_ARG_INT, &uv_offset, "Chroma plane offset in bytes", "BYTES" },
+	{ "file", 'f', 0, G_OPTION_ARG_FILENAME, &filename, "Raw NV12 frame(s) to show", "FILE" },
+	{ "format", 0, 0, G_OPTION_ARG_STRING, &format_name, "Frame format: nv12, nv21, i420, yv12, yuyv, uyvy or p010", "NAME" },
+	{ "transfer", 0, 0, G_OPTION_ARG_STRING, &transfer_name, "Transfer function: sdr, pq or hlg", "NAME" },
+	{ "peak-nits", 0, 0, G_OPTION_ARG_DOUBLE, &peak_nits, "HDR content peak luminance", "NITS" },
+	{ "source", 0, 0, G_OPTION_ARG_STRING, &source_name, "Frame source: still, file, mmap, gradient, noise, scroll or counter", "NAME" },
+	{ "prefetch", 0, 0, G_OPTION_ARG_INT, &prefetch, "Frames the mmap source reads ahead, 0 maps the whole file up front", "N" },
+	{ "mosaic", 'm', 0, G_OPTION_ARG_INT, &mosaic, "Show N streams as a video wall", "N" },
+	{ "upload", 'u', 0, G_OPTION_ARG_STRING, &upload_name, "Upload strategy: auto, direct or persistent", "NAME" },
+	{ "scale", 0, 0, G_OPTION_ARG_STRING, &scale_name, "Scaling kernel: bilinear, tent, catmull-rom, lanczos2 or lanczos3", "NAME" },
+	{ "chroma-siting", 0, 0, G_OPTION_ARG_STRING, &siting_name, "Chroma siting for the separable kernels: left, center or topleft", "NAME" },
+	{ "no-downscale", 0, G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &downscale, "Sample the mosaic at full resolution instead of from a mip chain", NULL },
+	{ "osd", 0, 0, G_OPTION_ARG_INT, &osd, "Draw N overlay rectangles and glyphs over the video: labelled, timestamped cells", "N" },
+	{ "hud", 0, 0, G_OPTION_ARG_NONE, &show_hud, "Show frame rate, frame times, upload rate and queue depth over the video", NULL },
+	{ "no-state-cache", 0, 0, G_OPTION_ARG_NONE, &no_state_cache, "Issue every GL state call, even redundant ones", NULL },
+	{ "tile", 't', 0, G_OPTION_ARG_INT, &tile, "Dirty tile size in luma pixels", "PIXELS" },
+	{ NULL }
+};
 
 static void
 init_gl(void)
 {
-	extern const uint32_t raw_512x512_nv12[];
-	uint8_t *luma = &((uint8_t *)raw_512x512_nv12)[0];
-	uint8_t *chroma = &((uint8_t *)raw_512x512_nv12)[width * height];
-	GLuint frag, vert;
+	static const char *const attribs[] = { "in_Position", "in_Color", "in_TexCoord", NULL };
 	GLuint program;
-	GLint status;
-
-	frag = create_shader(frag_shader_text, GL_FRAGMENT_SHADER);
-	vert = create_shader(vert_shader_text, GL_VERTEX_SHADER);
-
-	program = glCreateProgram();
-	glAttachShader(program, frag);
-	glAttachShader(program, vert);
-	glLinkProgram(program);
-
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (!status) {
-		char log[1000];
-		GLsizei len;
-		glGetProgramInfoLog(program, 1000, &len, log);
-		fprintf(stderr, "Error: linking:\n%.*s\n", len, log);
-		exit(1);
+
+	if (format == TEX_FORMAT_P010) {
+		gboolean norm16 = tex_stream_use_norm16(&stream);
+
+		printf("p010: %s, %s transfer\n", norm16 ? "16 bit textures" : "8 bit channel pairs",
+		       yuv_transfer_name(transfer));
 	}
 
-	glUseProgram(program);
+	program = program_get(vert_shader_text, yuv_frag_shader(&stream, transfer), attribs);
+	yuv_program_init(program, peak_nits);
 
 	gl.pos = 0;
 	gl.col = 1;
 	gl.tex = 2;
 
-	glBindAttribLocation(program, gl.pos, "in_Position");
-	glBindAttribLocation(program, gl.col, "in_Color");
-	glBindAttribLocation(program, gl.tex, "in_TexCoord");
-	glLinkProgram(program);
+	// Load textures, plane i on unit i
+	tex_stream_create_textures(&stream);
+	if (!tex_stream_set_upload(&stream, upload))
+		exit(1);
+	tex_stream_update(&stream, frame);
+
+	/* Wider kernels read further across tile edges. */
+	if (kernel != SCALE_BILINEAR) {
+		scaler_init(&scaler, kernel, siting);
+		printf("scaler: %s, %s chroma siting, %s intermediates\n",
+		       scale_kernel_name(kernel), siting_name ? siting_name : "left",
+		       scaler.luma_format == GL_R16F ? "half float" : "8 bit");
+		presenter.radius = scaler_radius(&scaler);
+	}
+}
 
-	gl.utexture_y = glGetUniformLocation(program, "uTexY");
-	gl.utexture_uv = glGetUniformLocation(program, "uTexUV");
+static void
+init_mosaic_gl(void)
+{
+	GLuint program;
+	GLuint tex[2], vbo[2];
+	GLfloat *inst;
+	int cols, rows, i;
+	static const GLfloat quad[4][2] = {
+		{ 0.0f, 0.0f },
+		{ 1.0f, 0.0f },
+		{ 1.0f, 1.0f },
+		{ 0.0f, 1.0f }
+	};
 
-	// Load textures
-	GLuint tex[2];
-	glGenTextures(2, tex);
+	// Load one array layer per stream
+	gl_state_active_texture(GL_TEXTURE0);
+	tex[0] = tex_pool_get(GL_TEXTURE_2D_ARRAY, GL_R8, width, height, mosaic, 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	gl_state_active_texture(GL_TEXTURE1);
+	tex[1] = tex_pool_get(GL_TEXTURE_2D_ARRAY, GL_RG8, (width + 1) / 2, (height + 1) / 2, mosaic, 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glCheckError();
 
-	// Luma
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (i = 0; i < mosaic; i++) {
+		const uint8_t *buf = frame_source_get(source, i);
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		gl_state_active_texture(GL_TEXTURE0);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1,
+				GL_RED, GL_UNSIGNED_BYTE, buf);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, luma);
+		gl_state_active_texture(GL_TEXTURE1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, uv_stride / 2);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, (width + 1) / 2, (height + 1) / 2, 1,
+				GL_RG, GL_UNSIGNED_BYTE, &buf[uv_offset]);
+		frame_source_release(source, buf);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 	glCheckError();
 
-	// Chroma
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tex[1]);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-#if 1
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width/2, height/2, 0, GL_RG, GL_UNSIGNED_BYTE, chroma);
-#else
-	// This means the fragment shader should use r and a, instead of x and y.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, width/2, height/2, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, chroma);
-#endif
+	/* The streams are stills, so the chain is built once. */
+	if (downscale) {
+		mipchain_init(&mip, width, height, mosaic);
+		mipchain_convert_nv12(&mip, tex[0], tex[1]);
+
+		program = program_get(mosaic_vert_shader_text, mosaic_mip_frag_shader_text, NULL);
+		gl_state_use_program(program);
+		gl_state_uniform1i(glGetUniformLocation(program, "uTex"), 2);
+		gl.ulod = glGetUniformLocation(program, "uLod");
+		gl.lod = -1.0f;
+	} else {
+		program = program_get(mosaic_vert_shader_text, mosaic_frag_shader_text, NULL);
+		gl_state_use_program(program);
+		gl_state_uniform1i(glGetUniformLocation(program, "uTexY"), 0);
+		gl_state_uniform1i(glGetUniformLocation(program, "uTexUV"), 1);
+	}
+
+	// Tile rect (top-left and bottom-right, in NDC) and layer per instance
+	cols = gl.cols = ceil(sqrt(mosaic));
+	rows = gl.rows = (mosaic + cols - 1) / cols;
+	inst = g_new(GLfloat, mosaic * 5);
+	for (i = 0; i < mosaic; i++) {
+		GLfloat *t = &inst[i * 5];
+
+		t[0] = -1.0f + 2.0f * (i % cols) / cols;
+		t[1] =  1.0f - 2.0f * (i / cols) / rows;
+		t[2] = t[0] + 2.0f / cols;
+		t[3] = t[1] - 2.0f / rows;
+		t[4] = i;
+	}
+
+	glGenVertexArrays(1, &gl.mosaic_vao);
+	gl_state_bind_vertex_array(gl.mosaic_vao);
+	glGenBuffers(2, vbo);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
+	glBufferData(GL_ARRAY_BUFFER, mosaic * 5 * sizeof(GLfloat), inst, GL_STATIC_DRAW);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *)0);
+	glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void *)(4 * sizeof(GLfloat)));
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
 	glCheckError();
+
+	g_free(inst);
 }
 
 static void realize_cb (GtkWidget *widget)
 {
-	static const EGLint context_attribs[] = {
-		EGL_CONTEXT_MAJOR_VERSION, 3,
-		EGL_NONE
-	};
-	EGLint attributes[] = {
-		EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-		EGL_RED_SIZE, 1,
-		EGL_GREEN_SIZE, 1,
-		EGL_BLUE_SIZE, 1,
-		EGL_ALPHA_SIZE, 1,
-		EGL_NONE
-	};
-
-	EGLConfig egl_config;
-	EGLint major, minor, n_config;
-	EGLBoolean ret;
-
-	egl_display = eglGetDisplay((EGLNativeDisplayType) gdk_x11_display_get_xdisplay (gtk_widget_get_display (widget)));
-
-	ret = eglInitialize(egl_display, &major, &minor);
-	assert(ret == EGL_TRUE);
+	render_ctx_init(&ctx, widget, RENDER_API_GLES);
+	gl_state_enable(!no_state_cache);
+
+	if (mosaic)
+		init_mosaic_gl();
+	else
+		init_gl();
+	if (osd)
+		overlay_init(&overlay);
+	if (show_hud)
+		hud_init(&hud);
+}
 
-	ret = eglBindAPI(EGL_OPENGL_ES_API);
-	assert(ret == EGL_TRUE);
+/* Window pixels to frame pixels, rounded outwards. */
+static void
+damage_window_rect(struct damage *damage, int ww, int wh, int x, int y, int w, int h)
+{
+	damage_add_rect(damage, x * width / ww, y * height / wh,
+			(w * width + ww - 1) / ww + 1, (h * height + wh - 1) / wh + 1);
+}
 
-	eglChooseConfig(egl_display, attributes, &egl_config, 1, &n_config);
-	egl_surface = eglCreateWindowSurface(egl_display, egl_config, gdk_x11_window_get_xid (gtk_widget_get_window (widget)), NULL);
-	assert(egl_surface);
+/*
+ * Overlay cells on a grid over the window, the mosaic's own when there
+ * are as many cells as streams: a border and a label with the stream
+ * time. Each cell is 4 border quads, the label background and 17
+ * glyphs. The labels change every frame, their tiles are damaged.
+ */
+#define OSD_CELL_QUADS 22
+#define OSD_LABEL_CHARS 19	/* "CAM 01 00:00:00.000" */
 
-	egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
-	assert(egl_context);
+static void
+build_osd(int ww, int wh, struct damage *damage)
+{
+	static gint64 start;
+	int cells = MAX(osd / OSD_CELL_QUADS, 1);
+	int cols = ceil(sqrt(cells)), rows = (cells + cols - 1) / cols;
+	int cw = ww / cols, ch = wh / rows;
+	int scale = cw >= 2 * OSD_LABEL_CHARS * FONT_CELL_WIDTH + 8 ? 2 : 1;
+	gint64 t;
+	int i;
+
+	if (!start)
+		start = g_get_monotonic_time();
+	t = (g_get_monotonic_time() - start) / 1000;
+
+	overlay_begin(&overlay, ww, wh);
+	for (i = 0; i < cells; i++) {
+		int x = i % cols * cw, y = i / cols * ch;
+		int lw = OSD_LABEL_CHARS * FONT_CELL_WIDTH * scale + 4, lh = FONT_CELL_HEIGHT * scale + 4;
+		char label[32];
+
+		snprintf(label, sizeof(label), "CAM %02d %02d:%02d:%02d.%03d", i % 100,
+			 (int)(t / 3600000 % 100), (int)(t / 60000 % 60), (int)(t / 1000 % 60),
+			 (int)(t % 1000));
+		overlay_border(&overlay, x, y, cw, ch, 2, 0xffffffc0);
+		overlay_rect(&overlay, x + 4, y + 4, lw, lh, 0x00000080);
+		overlay_text(&overlay, x + 6, y + 6, scale, label, 0xffff40ff);
+
+		if (damage)
+			damage_window_rect(damage, ww, wh, x + 4, y + 4, lw, lh);
+	}
+	overlay_end(&overlay);
+}
 
-	ret = eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
-	assert(ret == EGL_TRUE);
+static void draw_quad(void *data)
+{
+	(void)data;
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	if (osd)
+		overlay_draw(&overlay);
+	if (show_hud)
+		hud_draw(&hud);
+}
 
-        printf("using GL setup: \n"
-                "   renderer '%s'\n"
-                "   vendor '%s'\n"
-                "   GL version '%s'\n"
-                "   GLSL version '%s'\n",
-                glGetString(GL_RENDERER), glGetString(GL_VENDOR),
-                glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
+static void draw_scaled(void *data)
+{
+	scaler_draw(&scaler, *(int *)data);
+	if (osd)
+		overlay_draw(&overlay);
+	if (show_hud)
+		hud_draw(&hud);
+}
 
-	init_gl();
+/* Account for one presented frame. */
+static void drawn(void)
+{
+	frame_loop_drawn(&loop);
+	if (show_hud)
+		hud_frame(&hud, stream.uploaded_total, frame_source_queued(source));
 }
 
 static gboolean draw_cb (GtkWidget *widget)
@@ -233,52 +421,201 @@ static gboolean draw_cb (GtkWidget *widget)
 		{ 1, 1, 1 }
 	};
 
-	glViewport (0, 0, gtk_widget_get_allocated_width (widget), gtk_widget_get_allocated_height (widget));
-
-	glVertexAttribPointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, verts);
-	glVertexAttribPointer(gl.tex, 2, GL_FLOAT, GL_FALSE, 0, texcoords);
-	glVertexAttribPointer(gl.col, 3, GL_FLOAT, GL_FALSE, 0, colors);
+	int ww = gtk_widget_get_allocated_width (widget);
+	int wh = gtk_widget_get_allocated_height (widget);
+	int hud_rect[4];
+
+	gl_state_frame();
+	gl_state_viewport(0, 0, ww, wh);
+
+	if (mosaic) {
+		if (downscale) {
+			float lod = mipchain_lod(&mip, ww / gl.cols, wh / gl.rows);
+
+			if (lod != gl.lod) {
+				size_t mip_bytes, full_bytes;
+
+				mipchain_footprint(&mip, lod, &mip_bytes, &full_bytes);
+				printf("downscale: %dx%d tiles sample level %.2f, %zu KiB per frame "
+				       "instead of %zu KiB at full resolution (%.1f%% saved)\n",
+				       ww / gl.cols, wh / gl.rows, lod,
+				       mosaic * mip_bytes / 1024, mosaic * full_bytes / 1024,
+				       100.0 - 100.0 * mip_bytes / full_bytes);
+				gl_state_uniform1f(gl.ulod, lod);
+				gl.lod = lod;
+			}
+		}
+		glClear(GL_COLOR_BUFFER_BIT);
+		glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, mosaic);
+		if (osd) {
+			build_osd(ww, wh, NULL);
+			overlay_draw(&overlay);
+		}
+		if (show_hud) {
+			hud_update(&hud, ww, wh, hud_rect);
+			hud_draw(&hud);
+		}
+		render_ctx_swap(&ctx);
+		drawn();
+		return TRUE;
+	}
 
-	glEnableVertexAttribArray(gl.pos);
-	glEnableVertexAttribArray(gl.tex);
-	glEnableVertexAttribArray(gl.col);
+	/*
+	 * A new frame only damages the tiles that changed, a new overlay
+	 * only its labels and the HUD. Anything else (expose, resize)
+	 * repaints the whole window.
+	 */
+	if (stream.shown != frame)
+		tex_stream_update(&stream, frame);
+	else if (osd_ticked)
+		damage_clear(&stream.damage);
+	else
+		damage_all(&stream.damage);
+	osd_ticked = FALSE;
+	if (osd)
+		build_osd(ww, wh, &stream.damage);
+	if (show_hud) {
+		hud_update(&hud, ww, wh, hud_rect);
+		damage_window_rect(&stream.damage, ww, wh, hud_rect[0], hud_rect[1],
+				   hud_rect[2], hud_rect[3]);
+	}
 
-	glUniform1i(gl.utexture_y,  0);
-	glUniform1i(gl.utexture_uv, 1);
+	if (kernel != SCALE_BILINEAR) {
+		scaler_prepare(&scaler, stream.planes[0].texture, stream.planes[1].texture,
+			       width, height, ww, &stream.damage);
+		if (presenter_present(&presenter, &ctx, &stream.damage, ww, wh, draw_scaled, &wh))
+			drawn();
+		return TRUE;
+	}
 
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	/* The same every frame: the tracker drops all but the first. */
+	gl_state_attrib_pointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, verts);
+	gl_state_attrib_pointer(gl.tex, 2, GL_FLOAT, GL_FALSE, 0, texcoords);
+	gl_state_attrib_pointer(gl.col, 3, GL_FLOAT, GL_FALSE, 0, colors);
 
-	glDisableVertexAttribArray(gl.pos);
-	glDisableVertexAttribArray(gl.tex);
-	glDisableVertexAttribArray(gl.col);
+	gl_state_enable_attrib(gl.pos);
+	gl_state_enable_attrib(gl.tex);
+	gl_state_enable_attrib(gl.col);
 
-	eglSwapBuffers (egl_display, egl_surface);
+	/* An identical new frame is neither drawn nor swapped. */
+	if (presenter_present(&presenter, &ctx, &stream.damage, ww, wh, draw_quad, NULL))
+		drawn();
 
+	/* The attributes stay enabled, nothing else draws from vertex array 0. */
 	return TRUE;
 }
 
-static gboolean redraw(GtkWidget *widget)
+/*
+ * Playback: pull the next frame from the source every tick. A frame not
+ * drawn yet is kept rather than replaced, the stream still diffs
+ * against the buffer of the frame before it; once it is shown that
+ * buffer goes back to the source for reuse.
+ */
+static gboolean tick(gpointer data)
 {
-	gtk_widget_queue_draw(widget);
+	(void)data;
+	if (frame != stream.shown)
+		return FALSE;
+
+	frame_source_release(source, prev);
+	prev = frame;
+	frame = frame_source_get(source, ++frame_count);
 
 	return TRUE;
 }
 
-int main (int argc, char **argv)
+/* The overlay clock and the HUD run on when the video does not. */
+static gboolean osd_tick(gpointer data)
 {
-	GtkWidget *w;
-
-	gtk_init(&argc, &argv);
+	(void)data;
+	if (!mosaic && frame != stream.shown)
+		return FALSE;
+	osd_ticked = TRUE;
+	return TRUE;
+}
 
-	w = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-	gtk_widget_set_double_buffered(GTK_WIDGET(w), FALSE);
-	g_signal_connect(G_OBJECT(w), "realize", G_CALLBACK(realize_cb), NULL);
-	g_signal_connect(G_OBJECT(w), "draw", G_CALLBACK(draw_cb), NULL);
-	g_timeout_add(34, (GSourceFunc) redraw, w);
+int main (int argc, char **argv)
+{
+	extern const uint32_t raw_512x512_nv12[];
+	const uint8_t *still = (const uint8_t *)raw_512x512_nv12;
+	int pitches[3];
+	size_t offsets[3];
+
+	if (!frame_loop_parse_args(&argc, &argv, entries))
+		return 1;
+	if (mosaic < 0) {
+		fprintf(stderr, "Error: bad number of streams %d\n", mosaic);
+		return 1;
+	}
+	if (osd < 0 || osd > OVERLAY_MAX_QUADS) {
+		fprintf(stderr, "Error: bad number of overlay elements %d\n", osd);
+		return 1;
+	}
+	if (upload_name && !tex_upload_from_name(upload_name, &upload))
+		return 1;
+	if (scale_name && !scale_kernel_from_name(scale_name, &kernel))
+		return 1;
+	if (siting_name && !chroma_siting_from_name(siting_name, &siting))
+		return 1;
+	if (format_name && !tex_format_from_name(format_name, &format))
+		return 1;
+	if (format == TEX_FORMAT_P010)
+		transfer = YUV_TRANSFER_PQ;
+	if (transfer_name && !yuv_transfer_from_name(transfer_name, &transfer))
+		return 1;
+	if (peak_nits <= 0) {
+		fprintf(stderr, "Error: bad peak luminance %g\n", peak_nits);
+		return 1;
+	}
+	if (format == TEX_FORMAT_RGBA) {
+		fprintf(stderr, "Error: RGBA frames are for gtkegles_tex_rgba\n");
+		return 1;
+	}
+	if (format != TEX_FORMAT_NV12 && (mosaic || kernel != SCALE_BILINEAR)) {
+		fprintf(stderr, "Error: --mosaic and --scale need nv12 frames\n");
+		return 1;
+	}
 
-	gtk_widget_show(w);
+	/* Both chroma planes of I420 and YV12 share the pitch, V follows U by default. */
+	pitches[0] = stride;
+	pitches[1] = pitches[2] = uv_stride;
+	offsets[0] = offsets[2] = 0;
+	offsets[1] = uv_offset;
+	if (!tex_stream_init(&stream, format, width, height, pitches, offsets, tile))
+		return 1;
+
+	/* The built in still is NV12, other formats get a converted copy. */
+	if (format != TEX_FORMAT_NV12) {
+		struct tex_stream layout;
+		uint8_t *converted;
+
+		tex_stream_init(&layout, format, 512, 512, NULL, NULL, tile);
+		converted = g_malloc(layout.frame_size);
+		frame_from_nv12(&layout, converted, still);
+		tex_stream_fini(&layout);
+		still = converted;
+	}
 
-	gtk_main();
+	if (source_name && !strcmp(source_name, "mmap"))
+		source = frame_store_new(&stream, filename, prefetch);
+	else
+		source = frame_source_new(source_name, &stream, filename, still);
+	if (!source)
+		return 1;
+	frame = frame_source_get(source, 0);
+	presenter_init(&presenter, &stream.damage);
+
+	/* The mosaic reads the layout back from the stream. */
+	stride = stream.planes[0].pitch;
+	uv_stride = stream.planes[1].pitch;
+	uv_offset = stream.planes[1].offset;
+
+	loop.interval = 34;
+	if (source->nframes != 1 && !mosaic)
+		loop.tick = tick;
+	else if (osd || show_hud)
+		loop.tick = osd_tick;
+	frame_loop_run(&loop, G_CALLBACK(realize_cb), G_CALLBACK(draw_cb));
 
 	return 0;
 }
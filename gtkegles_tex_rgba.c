@@ -4,15 +4,35 @@
 #include <sys/time.h>
 
 #include <gtk/gtk.h>
-#include <gdk/gdkx.h>
-#include <GLES2/gl2.h>
-#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+
+#include "context.h"
+#include "frameloop.h"
+#include "framesource.h"
+#include "glstate.h"
+#include "ktx.h"
+#include "present.h"
+#include "program.h"
+#include "texpool.h"
+#include "texstream.h"
 
 static int width = 512;
 static int height = 512;
-static EGLDisplay *egl_display;
-static EGLSurface *egl_surface;
-static EGLContext *egl_context;
+static int stride;	/* pitch in bytes, defaults to width * 4 */
+static char *filename;
+static char *source_name;
+static char *overlay_name;
+static gboolean no_state_cache;
+static struct ktx overlay;	/* static logo drawn over the video, 1:1 in the top right corner */
+static GLuint overlay_texture;
+static struct frame_source *source;
+static const uint8_t *frame;	/* latest frame from the source */
+static const uint8_t *prev;	/* the one before, diff base until frame is shown */
+static unsigned int frame_count;
+static struct render_ctx ctx;
+static struct frame_loop loop;
+static struct tex_stream stream;
+static struct presenter presenter;
 struct {
 	GLuint pos;
 	GLuint col;
@@ -43,148 +63,97 @@ static const char *frag_shader_text =
 	"  gl_FragColor = texture2D(uTex, vTexCoord);\n"
 	"}\n";
 
-GLenum glCheckError_(const char *file, int line)
-{
-    GLenum errorCode;
-    while ((errorCode = glGetError()) != GL_NO_ERROR) {
-	printf("%d | %s:%d\n", errorCode, file, line);
-    }
-    return errorCode;
-}
-#define glCheckError() glCheckError_(__FILE__, __LINE__)
-
-static GLuint
-create_shader(const char *source, GLenum shader_type)
-{
-	GLuint shader;
-	GLint status;
-
-	shader = glCreateShader(shader_type);
-	glShaderSource(shader, 1, (const char **) &source, NULL);
-	glCompileShader(shader);
-
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char log[1000];
-		GLsizei len;
-		glGetShaderInfoLog(shader, 1000, &len, log);
-		fprintf(stderr, "Error: compiling %s: %.*s\n",
-			shader_type == GL_VERTEX_SHADER ? "vertex" : "fragment",
-			len, log);
-		exit(1);
-	}
-
-	return shader;
-}
+static GOptionEntry entries[] = {
+	{ "width", 'W', 0, G_OPTION_ARG_INT, &width, "Frame width", "W" },
+	{ "height", 'H', 0, G_OPTION_ARG_INT, &height, "Frame height", "H" },
+	{ "stride", 's', 0, G_OPTION_ARG_INT, &stride, "Pitch in bytes", "BYTES" },
+	{ "file", 'f', 0, G_OPTION_ARG_FILENAME, &filename, "Raw RGBA frame(s) to show", "FILE" },
+	{ "overlay", 'o', 0, G_OPTION_ARG_FILENAME, &overlay_name, "ETC2 or ASTC KTX to draw over the video", "FILE" },
+	{ "source", 0, 0, G_OPTION_ARG_STRING, &source_name, "Frame source: still, file, mmap, gradient, noise, scroll or counter", "NAME" },
+	{ "no-state-cache", 0, 0, G_OPTION_ARG_NONE, &no_state_cache, "Issue every GL state call, even redundant ones", NULL },
+	{ NULL }
+};
 
 static void
 init_gl(void)
 {
-	GLuint frag, vert;
+	static const char *const attribs[] = { "in_Position", "in_Color", "in_TexCoord", NULL };
 	GLuint program;
-	GLint status;
-
-	frag = create_shader(frag_shader_text, GL_FRAGMENT_SHADER);
-	vert = create_shader(vert_shader_text, GL_VERTEX_SHADER);
-
-	program = glCreateProgram();
-	glAttachShader(program, frag);
-	glAttachShader(program, vert);
-	glLinkProgram(program);
-
-	glGetProgramiv(program, GL_LINK_STATUS, &status);
-	if (!status) {
-		char log[1000];
-		GLsizei len;
-		glGetProgramInfoLog(program, 1000, &len, log);
-		fprintf(stderr, "Error: linking:\n%.*s\n", len, log);
-		exit(1);
-	}
 
-	glUseProgram(program);
+	program = program_get(vert_shader_text, frag_shader_text, attribs);
+	gl_state_use_program(program);
 
 	gl.pos = 0;
 	gl.col = 1;
 	gl.tex = 2;
 
-	glBindAttribLocation(program, gl.pos, "in_Position");
-	glBindAttribLocation(program, gl.col, "in_Color");
-	glBindAttribLocation(program, gl.tex, "in_TexCoord");
-	glLinkProgram(program);
-
 	gl.utexture = glGetUniformLocation(program, "uTex");
 
 	// Load texture
-	GLuint tex;
-	glGenTextures(1, &tex);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tex);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	extern const uint32_t raw_512x512_rgba[];
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, raw_512x512_rgba);
+	tex_stream_create_textures(&stream);
+	tex_stream_update(&stream, frame);
+
+	/* The overlay stays on unit 1, uploaded once, compressed. */
+	if (overlay_name) {
+		size_t bytes = 0, rgba = 0;
+		int i;
+
+		if (!ktx_format_supported(overlay.internal_format)) {
+			fprintf(stderr, "Error: the context can't sample %s\n",
+				ktx_format_name(overlay.internal_format));
+			exit(1);
+		}
+		gl_state_active_texture(GL_TEXTURE1);
+		overlay_texture = ktx_create_texture(&overlay);
+		gl_state_active_texture(GL_TEXTURE0);
+		ktx_fini(&overlay);
+
+		for (i = 0; i < overlay.levels; i++) {
+			bytes += overlay.level[i].size;
+			rgba += tex_image_bytes(GL_RGBA8, MAX(overlay.width >> i, 1),
+						MAX(overlay.height >> i, 1));
+		}
+		printf("overlay: %s %dx%d, %d levels, %.1f KiB, %.1f%% of RGBA8\n",
+		       ktx_format_name(overlay.internal_format), overlay.width, overlay.height,
+		       overlay.levels, bytes / 1024.0, 100.0 * bytes / rgba);
+	}
 }
 
 static void realize_cb (GtkWidget *widget)
 {
-	static const EGLint context_attribs[] = {
-		EGL_CONTEXT_MAJOR_VERSION, 3,
-		EGL_NONE
-	};
-	EGLint attributes[] = {
-		EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
-		EGL_RED_SIZE, 1,
-		EGL_GREEN_SIZE, 1,
-		EGL_BLUE_SIZE, 1,
-		EGL_ALPHA_SIZE, 1,
-		EGL_NONE
-	};
-
-	EGLConfig egl_config;
-	EGLint major, minor, n_config;
-	EGLBoolean ret;
-
-	egl_display = eglGetDisplay((EGLNativeDisplayType) gdk_x11_display_get_xdisplay (gtk_widget_get_display (widget)));
-
-	ret = eglInitialize(egl_display, &major, &minor);
-	assert(ret == EGL_TRUE);
+	render_ctx_init(&ctx, widget, RENDER_API_GLES);
+	gl_state_enable(!no_state_cache);
 
-	ret = eglBindAPI(EGL_OPENGL_ES_API);
-	assert(ret == EGL_TRUE);
-
-	eglChooseConfig(egl_display, attributes, &egl_config, 1, &n_config);
-	egl_surface = eglCreateWindowSurface(egl_display, egl_config, gdk_x11_window_get_xid (gtk_widget_get_window (widget)), NULL);
-	assert(egl_surface);
+	init_gl();
+}
 
-	egl_context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, context_attribs);
-	assert(egl_context);
+static const GLfloat verts[4][2] = {
+	{ -1.0f,  1.0f },
+	{  1.0f,  1.0f },
+	{  1.0f, -1.0f },
+	{ -1.0f, -1.0f }
+};
 
-	ret = eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context);
-	assert(ret == EGL_TRUE);
+static void draw_quad(void *data)
+{
+	const GLfloat *overlay_verts = data;
 
-        printf("using GL setup: \n"
-                "   renderer '%s'\n"
-                "   vendor '%s'\n"
-                "   GL version '%s'\n"
-                "   GLSL version '%s'\n",
-                glGetString(GL_RENDERER), glGetString(GL_VENDOR),
-                glGetString(GL_VERSION), glGetString(GL_SHADING_LANGUAGE_VERSION));
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	if (!overlay_verts)
+		return;
 
-	init_gl();
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	gl_state_uniform1i(gl.utexture, 1);
+	gl_state_attrib_pointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, overlay_verts);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	gl_state_attrib_pointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, verts);
+	gl_state_uniform1i(gl.utexture, 0);
+	glDisable(GL_BLEND);
 }
 
 static gboolean draw_cb (GtkWidget *widget)
 {
-	static const GLfloat verts[4][2] = {
-		{ -1.0f,  1.0f },
-		{  1.0f,  1.0f },
-		{  1.0f, -1.0f },
-		{ -1.0f, -1.0f }
-	};
 	static const GLfloat texcoords[4][2] = {
 		{  0.0f,  0.0f },
 		{  1.0f,  0.0f },
@@ -198,51 +167,84 @@ static gboolean draw_cb (GtkWidget *widget)
 		{ 1, 1, 1 }
 	};
 
-	glViewport (0, 0, gtk_widget_get_allocated_width (widget), gtk_widget_get_allocated_height (widget));
+	int ww = gtk_widget_get_allocated_width (widget);
+	int wh = gtk_widget_get_allocated_height (widget);
+	GLfloat overlay_verts[4][2];
 
-	glVertexAttribPointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, verts);
-	glVertexAttribPointer(gl.tex, 2, GL_FLOAT, GL_FALSE, 0, texcoords);
-	glVertexAttribPointer(gl.col, 3, GL_FLOAT, GL_FALSE, 0, colors);
+	gl_state_frame();
+	gl_state_viewport(0, 0, ww, wh);
 
-	glEnableVertexAttribArray(gl.pos);
-	glEnableVertexAttribArray(gl.tex);
-	glEnableVertexAttribArray(gl.col);
+	/* Expose and resize repaint everything, a new frame what changed. */
+	if (stream.shown != frame)
+		tex_stream_update(&stream, frame);
+	else
+		damage_all(&stream.damage);
 
-	glUniform1i(gl.utexture, 0); /* '0' refers to texture unit 0. */
+	/* The same every frame: the tracker drops all but the first. */
+	gl_state_attrib_pointer(gl.pos, 2, GL_FLOAT, GL_FALSE, 0, verts);
+	gl_state_attrib_pointer(gl.tex, 2, GL_FLOAT, GL_FALSE, 0, texcoords);
+	gl_state_attrib_pointer(gl.col, 3, GL_FLOAT, GL_FALSE, 0, colors);
 
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	gl_state_enable_attrib(gl.pos);
+	gl_state_enable_attrib(gl.tex);
+	gl_state_enable_attrib(gl.col);
+
+	gl_state_uniform1i(gl.utexture, 0); /* '0' refers to texture unit 0. */
 
-	glDisableVertexAttribArray(gl.pos);
-	glDisableVertexAttribArray(gl.tex);
-	glDisableVertexAttribArray(gl.col);
+	/* Pixel for texel, 16 pixels in from the top right corner. */
+	if (overlay_texture) {
+		GLfloat x1 = 1.0f - 32.0f / ww, x0 = x1 - 2.0f * overlay.width / ww;
+		GLfloat y0 = 1.0f - 32.0f / wh, y1 = y0 - 2.0f * overlay.height / wh;
 
-	eglSwapBuffers (egl_display, egl_surface);
+		overlay_verts[0][0] = overlay_verts[3][0] = x0;
+		overlay_verts[1][0] = overlay_verts[2][0] = x1;
+		overlay_verts[0][1] = overlay_verts[1][1] = y0;
+		overlay_verts[2][1] = overlay_verts[3][1] = y1;
+	}
 
+	if (presenter_present(&presenter, &ctx, &stream.damage, ww, wh, draw_quad,
+			      overlay_texture ? overlay_verts : NULL))
+		frame_loop_drawn(&loop);
+
+	/* The attributes stay enabled, nothing else draws from vertex array 0. */
 	return TRUE;
 }
 
-static gboolean redraw(GtkWidget *widget)
+/* Pull the next frame unless the last one is still waiting to be drawn. */
+static gboolean tick(gpointer data)
 {
-	gtk_widget_queue_draw(widget);
+	(void)data;
+	if (frame != stream.shown)
+		return FALSE;
+
+	frame_source_release(source, prev);
+	prev = frame;
+	frame = frame_source_get(source, ++frame_count);
 
 	return TRUE;
 }
 
 int main (int argc, char **argv)
 {
-	GtkWidget *w;
-
-	gtk_init(&argc, &argv);
-
-	w = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-	gtk_widget_set_double_buffered(GTK_WIDGET(w), FALSE);
-	g_signal_connect(G_OBJECT(w), "realize", G_CALLBACK(realize_cb), NULL);
-	g_signal_connect(G_OBJECT(w), "draw", G_CALLBACK(draw_cb), NULL);
-	g_timeout_add(34, (GSourceFunc) redraw, w);
-
-	gtk_widget_show(w);
+	extern const uint32_t raw_512x512_rgba[];
 
-	gtk_main();
+	if (!frame_loop_parse_args(&argc, &argv, entries))
+		return 1;
+	if (!tex_stream_init(&stream, TEX_FORMAT_RGBA, width, height, &stride, NULL, 64))
+		return 1;
+	source = frame_source_new(source_name, &stream, filename, (const uint8_t *)raw_512x512_rgba);
+	if (!source)
+		return 1;
+	frame = frame_source_get(source, 0);
+	if (overlay_name && !ktx_load(&overlay, overlay_name))
+		return 1;
+	presenter_init(&presenter, &stream.damage);
+
+	/* A still image needs no tick: expose and resize are the only reasons to draw. */
+	loop.interval = 34;
+	if (source->nframes != 1)
+		loop.tick = tick;
+	frame_loop_run(&loop, G_CALLBACK(realize_cb), G_CALLBACK(draw_cb));
 
 	return 0;
 }
@@ -0,0 +1,190 @@
+/*
+ * HDR path benchmark: uploads and converts one noise frame per path, 8
+ * bit NV12 against P010 as byte pairs and as 16 bit textures, with each
+ * transfer function, and prints what the upload moves and what the
+ * conversion costs, one CSV (or JSON) row per path and size. The draw
+ * column against the nv12 row is the ALU the HDR shaders add.
+ *
+ *   hdrbench --sizes 1920x1080,3840x2160 --json
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#include "bench.h"
+#include "context.h"
+#include "framesource.h"
+#include "program.h"
+#include "texpool.h"
+#include "texstream.h"
+#include "yuvshader.h"
+
+static struct render_ctx ctx;
+
+static char *sizes = "1920x1080,3840x2160";
+static char *path_names;
+
+static GOptionEntry entries[] = {
+	{ "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes, "Comma separated frame sizes", "WxH,..." },
+	{ "paths", 'p', 0, G_OPTION_ARG_STRING, &path_names, "Comma separated paths, all by default", "LIST" },
+	{ NULL }
+};
+
+static const struct path {
+	const char *name;
+	enum tex_format format;
+	gboolean norm16;
+	enum yuv_transfer transfer;
+} paths[] = {
+	{ "nv12-sdr", TEX_FORMAT_NV12, FALSE, YUV_TRANSFER_SDR },
+	{ "p010-bytes-sdr", TEX_FORMAT_P010, FALSE, YUV_TRANSFER_SDR },
+	{ "p010-bytes-pq", TEX_FORMAT_P010, FALSE, YUV_TRANSFER_PQ },
+	{ "p010-norm16-sdr", TEX_FORMAT_P010, TRUE, YUV_TRANSFER_SDR },
+	{ "p010-norm16-pq", TEX_FORMAT_P010, TRUE, YUV_TRANSFER_PQ },
+	{ "p010-norm16-hlg", TEX_FORMAT_P010, TRUE, YUV_TRANSFER_HLG },
+};
+
+struct result {
+	double upload_mb;	/* per frame */
+	double upload_ms;
+	double upload_mb_s;
+	double draw_ms;		/* conversion into an RGBA8 target */
+	double mpix_s;
+};
+
+struct frame {
+	const struct tex_stream *s;
+	const uint8_t *data;
+};
+
+/* Full frame upload of every plane, plane i on unit i. */
+static void
+upload(gpointer data, int n)
+{
+	const struct frame *f = data;
+	const struct tex_stream *s = f->s;
+	int i;
+
+	for (i = 0; i < s->nplanes; i++) {
+		const struct tex_plane *p = &s->planes[i];
+
+		glActiveTexture(GL_TEXTURE0 + i);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, p->pitch / p->bpp);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p->width, p->height, p->format,
+				p->type, &f->data[p->offset]);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+static void
+draw(gpointer data, int n)
+{
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/* FALSE when the path needs what the context lacks. */
+static gboolean
+run(const struct path *path, int width, int height, struct result *r)
+{
+	struct tex_stream s;
+	struct frame_source *source;
+	struct frame f = { .s = &s };
+	GLuint program, target;
+	size_t bytes = 0;
+	int i;
+
+	if (!tex_stream_init(&s, path->format, width, height, NULL, NULL, 64))
+		exit(1);
+	if (path->norm16 && !tex_stream_use_norm16(&s)) {
+		tex_stream_fini(&s);
+		return FALSE;
+	}
+	source = frame_source_new("noise", &s, NULL, NULL);
+	f.data = frame_source_get(source, 0);
+
+	tex_stream_create_textures(&s);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (i = 0; i < s.nplanes; i++)
+		bytes += (size_t)s.planes[i].width * s.planes[i].height * s.planes[i].bpp;
+
+	program = program_get(fullscreen_vert_shader(GL_TRUE), yuv_frag_shader(&s, path->transfer), NULL);
+	yuv_program_init(program, 1000.0f);
+
+	target = bench_target_get(width, height);
+
+	r->upload_mb = bytes / (1024.0 * 1024.0);
+	r->upload_ms = bench_time(upload, &f);
+	r->upload_mb_s = r->upload_mb / (r->upload_ms / 1000.0);
+	r->draw_ms = bench_time(draw, NULL);
+	r->mpix_s = (double)width * height / (r->draw_ms * 1000.0);
+
+	bench_target_put(target);
+	frame_source_release(source, f.data);
+	frame_source_destroy(source);
+	tex_stream_fini(&s);
+	glCheckError();
+
+	return TRUE;
+}
+
+static void
+print_row(const char *path, int width, int height, const struct result *r)
+{
+	bench_row_begin();
+	bench_field_str("path", path);
+	bench_field("width", "%d", width);
+	bench_field("height", "%d", height);
+	bench_field("frames", "%d", bench_frames());
+	bench_field("upload_mb", "%.2f", r->upload_mb);
+	bench_field("upload_ms", "%.3f", r->upload_ms);
+	bench_field("upload_mb_s", "%.1f", r->upload_mb_s);
+	bench_field("draw_ms", "%.3f", r->draw_ms);
+	bench_field("mpix_s", "%.1f", r->mpix_s);
+	bench_row_end();
+}
+
+int
+main(int argc, char **argv)
+{
+	gchar **size_list;
+	int s;
+	unsigned int p;
+
+	if (!bench_parse_args(&argc, &argv, entries, 100))
+		return 1;
+
+	if (!render_ctx_init_offscreen(&ctx, RENDER_API_GLES))
+		return 1;
+
+	size_list = g_strsplit(sizes, ",", -1);
+	for (s = 0; size_list[s]; s++) {
+		int width, height;
+
+		if (sscanf(size_list[s], "%dx%d", &width, &height) != 2 ||
+		    width <= 0 || height <= 0) {
+			fprintf(stderr, "Error: bad size '%s'\n", size_list[s]);
+			return 1;
+		}
+
+		for (p = 0; p < G_N_ELEMENTS(paths); p++) {
+			struct result r;
+
+			if (!bench_in_list(path_names, paths[p].name))
+				continue;
+			if (!run(&paths[p], width, height, &r)) {
+				fprintf(stderr, "%s: no 16 bit textures, skipped\n", paths[p].name);
+				continue;
+			}
+			print_row(paths[p].name, width, height, &r);
+		}
+	}
+	bench_finish();
+
+	g_strfreev(size_list);
+
+	return 0;
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "font.h"
+#include "glstate.h"
+#include "hud.h"
+#include "overlay.h"
+#include "program.h"
+
+#define HUD_MARGIN 8
+#define HUD_PAD 4
+#define HUD_SCALE 2		/* text at twice the font size */
+#define HUD_LINE (FONT_CELL_HEIGHT * HUD_SCALE + 2)
+#define HUD_LINES 3
+#define HUD_CHARS 22		/* "FPS  59.9 MAX  16.7 MS" */
+#define HUD_BAR 2		/* graph bar width in pixels */
+#define HUD_GRAPH_HEIGHT 50	/* pixels, one per ms */
+
+static const char *vert_shader_text =
+	"#version 300 es				\n"
+	"layout(location = 0) in vec2 in_Corner;	\n"
+	"layout(location = 1) in vec4 in_Rect;		\n"
+	"layout(location = 2) in vec4 in_Tex;		\n"
+	"layout(location = 3) in vec4 in_Color;		\n"
+	"						\n"
+	"uniform vec2 uScale;				\n"
+	"uniform vec2 uTexScale;			\n"
+	"						\n"
+	"out vec2 vTexCoord;				\n"
+	"out vec4 vColor;				\n"
+	"						\n"
+	"void main() {					\n"
+	"  vec2 p = in_Rect.xy + in_Corner * in_Rect.zw;\n"
+	"  gl_Position = vec4(p * uScale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+	"  vTexCoord = (in_Tex.xy + in_Corner * in_Tex.zw) * uTexScale;\n"
+	"  vColor = in_Color;				\n"
+	"}						\n";
+
+/* Triangle strip corners of the unit quad every instance stretches. */
+static const GLubyte corners[4][2] = {
+	{ 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 },
+};
+
+void
+hud_init(struct hud *h)
+{
+	GLuint program;
+
+	memset(h, 0, sizeof(*h));
+	program = gl_state_program();
+
+	h->program = program_get(vert_shader_text, overlay_frag_shader(), NULL);
+	gl_state_use_program(h->program);
+	gl_state_uniform1i(glGetUniformLocation(h->program, "uAtlas"), OVERLAY_UNIT);
+	glUniform2f(glGetUniformLocation(h->program, "uTexScale"),
+		    1.0f / FONT_ATLAS_WIDTH, 1.0f / FONT_ATLAS_HEIGHT);
+	h->uscale = glGetUniformLocation(h->program, "uScale");
+	overlay_atlas_get();
+
+	glGenVertexArrays(1, &h->vao);
+	gl_state_bind_vertex_array(h->vao);
+	glGenBuffers(1, &h->quad);
+	glBindBuffer(GL_ARRAY_BUFFER, h->quad);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_UNSIGNED_BYTE, GL_FALSE, 0, 0);
+
+	glGenBuffers(1, &h->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, h->vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(h->inst), NULL, GL_STREAM_DRAW);
+	glVertexAttribPointer(1, 4, GL_SHORT, GL_FALSE, sizeof(struct hud_instance),
+			      (void *)G_STRUCT_OFFSET(struct hud_instance, x));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(struct hud_instance),
+			      (void *)G_STRUCT_OFFSET(struct hud_instance, u));
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(struct hud_instance),
+			      (void *)G_STRUCT_OFFSET(struct hud_instance, color));
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+	gl_state_bind_vertex_array(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state_use_program(program);
+	glCheckError();
+}
+
+void
+hud_fini(struct hud *h)
+{
+	glDeleteVertexArrays(1, &h->vao);
+	glDeleteBuffers(1, &h->quad);
+	glDeleteBuffers(1, &h->vbo);
+	overlay_atlas_put();
+}
+
+void
+hud_frame(struct hud *h, uint64_t uploaded, int queued)
+{
+	gint64 now = g_get_monotonic_time();
+
+	if (h->last) {
+		h->frame_ms[h->head] = (now - h->last) / 1000.0f;
+		h->head = (h->head + 1) % HUD_HISTORY;
+	}
+	h->last = now;
+	h->queued = queued;
+
+	/* Rates over whole seconds, the counters are running totals. */
+	if (h->second) {
+		h->frames++;
+		if (now - h->second < G_USEC_PER_SEC)
+			return;
+		h->fps = h->frames * (double)G_USEC_PER_SEC / (now - h->second);
+		h->upload_mb_s = (uploaded - h->uploaded) / (double)(now - h->second);
+	}
+	h->frames = 0;
+	h->second = now;
+	h->uploaded = uploaded;
+}
+
+static void
+add(void *data, const struct overlay_quad *q)
+{
+	struct hud *h = data;
+	struct hud_instance *i;
+
+	if (h->count == HUD_MAX_INSTANCES)
+		return;
+
+	i = &h->inst[h->count++];
+	i->x = q->x;
+	i->y = q->y;
+	i->w = q->w;
+	i->h = q->h;
+	i->u = q->u;
+	i->v = q->v;
+	i->uw = q->uw;
+	i->vh = q->vh;
+	memcpy(i->color, q->color, 4);
+}
+
+static void
+rect(struct hud *h, int x, int y, int w, int ht, uint32_t color)
+{
+	overlay_layout_rect(add, h, x, y, w, ht, color);
+}
+
+static void
+text(struct hud *h, int x, int y, const char *s, uint32_t color)
+{
+	overlay_layout_text(add, h, x, y, HUD_SCALE, s, color);
+}
+
+void
+hud_update(struct hud *h, int width, int height, int *r)
+{
+	gint64 start = g_get_monotonic_time(), now;
+	int x = HUD_MARGIN + HUD_PAD, y = HUD_MARGIN + HUD_PAD;
+	int graph = y + HUD_LINES * HUD_LINE + HUD_PAD;
+	float mean = 0, worst = 0;
+	int i, n = 0;
+	char line[32];
+
+	h->width = width;
+	h->height = height;
+	h->count = 0;
+
+	for (i = 0; i < HUD_HISTORY; i++) {
+		if (!h->frame_ms[i])
+			continue;
+		mean += h->frame_ms[i];
+		worst = MAX(worst, h->frame_ms[i]);
+		n++;
+	}
+	if (n)
+		mean /= n;
+
+	r[0] = HUD_MARGIN;
+	r[1] = HUD_MARGIN;
+	r[2] = MAX(HUD_HISTORY * HUD_BAR, HUD_CHARS * FONT_CELL_WIDTH * HUD_SCALE) + 2 * HUD_PAD;
+	r[3] = graph + HUD_GRAPH_HEIGHT + HUD_PAD - HUD_MARGIN;
+	rect(h, r[0], r[1], r[2], r[3], 0x000000a0);
+
+	snprintf(line, sizeof(line), "FPS %5.1f MAX %5.1f MS", MIN(h->fps, 999.9f),
+		 MIN(worst, 999.9f));
+	text(h, x, y, line, 0xffffffff);
+	snprintf(line, sizeof(line), "UPLOAD %7.1f MB/S", h->upload_mb_s);
+	text(h, x, y + HUD_LINE, line, 0xffffffff);
+	snprintf(line, sizeof(line), "QUEUE %d", h->queued);
+	text(h, x, y + 2 * HUD_LINE, line, 0xffffffff);
+
+	/* Oldest frame on the left; a frame half again as long as the mean is a hitch. */
+	for (i = 0; i < HUD_HISTORY; i++) {
+		float ms = h->frame_ms[(h->head + i) % HUD_HISTORY];
+		int bar = MIN((int)(ms + 0.5f), HUD_GRAPH_HEIGHT);
+
+		if (bar)
+			rect(h, x + i * HUD_BAR, graph + HUD_GRAPH_HEIGHT - bar, HUD_BAR, bar,
+			     ms > 1.5f * mean ? 0xff4040ff : 0x40ff40ff);
+	}
+	/* 60 and 30 Hz frame times. */
+	rect(h, x, graph + HUD_GRAPH_HEIGHT - 17, HUD_HISTORY * HUD_BAR, 1, 0xffffff60);
+	rect(h, x, graph + HUD_GRAPH_HEIGHT - 33, HUD_HISTORY * HUD_BAR, 1, 0xffffff60);
+
+	overlay_upload(h->vbo, sizeof(h->inst), h->inst, h->count * sizeof(struct hud_instance));
+
+	now = g_get_monotonic_time();
+	h->stats.cpu += now - start;
+	h->stats.frames++;
+	if (!h->stats.since)
+		h->stats.since = now;
+	if (now - h->stats.since >= G_USEC_PER_SEC) {
+		printf("hud: %d instances, %.3f ms CPU per frame, %u frames\n", h->count,
+		       h->stats.cpu / 1000.0 / h->stats.frames, h->stats.frames);
+		memset(&h->stats, 0, sizeof(h->stats));
+		h->stats.since = now;
+	}
+}
+
+void
+hud_draw(struct hud *h)
+{
+	gint64 start = g_get_monotonic_time();
+	GLuint program, vao;
+
+	program = gl_state_program();
+	vao = gl_state_vertex_array();
+
+	gl_state_use_program(h->program);
+	glUniform2f(h->uscale, 2.0f / h->width, -2.0f / h->height);
+	gl_state_bind_vertex_array(h->vao);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, h->count);
+	glDisable(GL_BLEND);
+
+	gl_state_bind_vertex_array(vao);
+	gl_state_use_program(program);
+
+	h->stats.cpu += g_get_monotonic_time() - start;
+}
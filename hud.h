@@ -0,0 +1,72 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdint.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+/* Frame times the graph shows, one bar each. */
+#define HUD_HISTORY 120
+#define HUD_MAX_INSTANCES 512
+
+/*
+ * Stats HUD: frame rate, a frame time graph, upload rate and queue
+ * depth in the top left corner of the window. Every glyph and graph bar
+ * is one instance of a single unit quad, placed and textured from the
+ * font atlas the OSD layer shares, by the vertex shader, so a frame of
+ * HUD is one small instance upload and one instanced draw.
+ */
+struct hud_instance {
+	GLshort x, y, w, h;	/* window pixels, top left origin */
+	GLubyte u, v, uw, vh;	/* atlas texels */
+	GLubyte color[4];	/* premultiplied */
+};
+
+struct hud {
+	GLuint program, vao, quad, vbo;
+	GLint uscale;
+	struct hud_instance inst[HUD_MAX_INSTANCES];
+	int count;
+	int width, height;
+
+	float frame_ms[HUD_HISTORY];	/* ring, newest at head - 1 */
+	int head;
+	gint64 last;		/* time of the last frame */
+	uint64_t uploaded;	/* counter value at the start of the second */
+	int queued;
+	float fps, upload_mb_s;
+	int frames;		/* in the current second */
+	gint64 second;		/* start of it */
+
+	struct {
+		unsigned int frames;
+		gint64 cpu;	/* us building, uploading and issuing */
+		gint64 since;
+	} stats;
+};
+
+/* Need a current context. Leaves the current program alone. */
+void hud_init(struct hud *h);
+void hud_fini(struct hud *h);
+
+/*
+ * Account for one presented frame: uploaded is a running byte count
+ * (tex_stream.uploaded_total), queued the frames ready behind it.
+ */
+void hud_frame(struct hud *h, uint64_t uploaded, int queued);
+
+/*
+ * Lay out and upload the HUD for a width x height window. rect is set to
+ * the window pixels it covers, x, y, w, h, for damage.
+ */
+void hud_update(struct hud *h, int width, int height, int *rect);
+
+/*
+ * Draw it into the bound framebuffer, in one call. Can be called more
+ * than once per update, e.g. once per scissor rect. The program and
+ * vertex array are restored, blending is left off.
+ */
+void hud_draw(struct hud *h);
+
+#endif
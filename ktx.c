@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include "context.h"
+#include "ktx.h"
+#include "program.h"
+#include "texpool.h"
+
+#define KTX_HEADER_SIZE 64
+#define KTX_ENDIANNESS 0x04030201
+
+static const uint8_t ktx_identifier[12] = {
+	0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n'
+};
+
+/* Header words after the identifier, in file order. */
+enum {
+	KTX_ENDIAN, KTX_TYPE, KTX_TYPE_SIZE, KTX_FORMAT, KTX_INTERNAL_FORMAT,
+	KTX_BASE_INTERNAL_FORMAT, KTX_WIDTH, KTX_HEIGHT, KTX_DEPTH, KTX_ARRAY_ELEMENTS,
+	KTX_FACES, KTX_LEVELS, KTX_KEY_VALUE_BYTES, KTX_WORDS
+};
+
+#define ASTC(size) \
+	{ GL_COMPRESSED_RGBA_ASTC_##size##_KHR, "astc-" #size }, \
+	{ GL_COMPRESSED_SRGB8_ALPHA8_ASTC_##size##_KHR, "astc-" #size "-srgb" }
+
+static const struct {
+	GLenum internal_format;
+	const char *name;
+} formats[] = {
+	{ GL_COMPRESSED_RGB8_ETC2, "etc2-rgb8" },
+	{ GL_COMPRESSED_SRGB8_ETC2, "etc2-srgb8" },
+	{ GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, "etc2-rgb8a1" },
+	{ GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, "etc2-srgb8a1" },
+	{ GL_COMPRESSED_RGBA8_ETC2_EAC, "etc2-rgba8" },
+	{ GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, "etc2-srgb8-alpha8" },
+	{ GL_COMPRESSED_R11_EAC, "eac-r11" },
+	{ GL_COMPRESSED_SIGNED_R11_EAC, "eac-r11-snorm" },
+	{ GL_COMPRESSED_RG11_EAC, "eac-rg11" },
+	{ GL_COMPRESSED_SIGNED_RG11_EAC, "eac-rg11-snorm" },
+	ASTC(4x4), ASTC(5x4), ASTC(5x5), ASTC(6x5), ASTC(6x6), ASTC(8x5), ASTC(8x6),
+	ASTC(8x8), ASTC(10x5), ASTC(10x6), ASTC(10x8), ASTC(10x10), ASTC(12x10), ASTC(12x12),
+};
+
+const char *
+ktx_format_name(GLenum internal_format)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(formats); i++)
+		if (formats[i].internal_format == internal_format)
+			return formats[i].name;
+	return NULL;
+}
+
+gboolean
+ktx_format_supported(GLenum internal_format)
+{
+	const char *name = ktx_format_name(internal_format);
+
+	if (!name)
+		return FALSE;
+	if (strncmp(name, "astc-", 5))
+		return TRUE;
+	return has_extension((const char *)glGetString(GL_EXTENSIONS),
+			     "GL_KHR_texture_compression_astc_ldr");
+}
+
+static uint32_t
+read_word(const uint8_t *p, gboolean swap)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return swap ? GUINT32_SWAP_LE_BE(v) : v;
+}
+
+/* Check the header and find the levels; data and len are already set. */
+static gboolean
+parse(struct ktx *k, const char *filename)
+{
+	uint32_t h[KTX_WORDS];
+	size_t offset;
+	gboolean swap;
+	int i;
+
+	if (k->len < KTX_HEADER_SIZE || memcmp(k->data, ktx_identifier, sizeof(ktx_identifier))) {
+		fprintf(stderr, "Error: %s is not a KTX 1.1 file\n", filename);
+		return FALSE;
+	}
+	swap = read_word(&k->data[sizeof(ktx_identifier)], FALSE) != KTX_ENDIANNESS;
+	for (i = 0; i < KTX_WORDS; i++)
+		h[i] = read_word(&k->data[sizeof(ktx_identifier) + 4 * i], swap);
+	if (h[KTX_ENDIAN] != KTX_ENDIANNESS) {
+		fprintf(stderr, "Error: %s has a bad endianness mark\n", filename);
+		return FALSE;
+	}
+
+	/* glType and glFormat are 0 for compressed data. */
+	if (h[KTX_TYPE] || h[KTX_FORMAT] || !ktx_format_name(h[KTX_INTERNAL_FORMAT])) {
+		fprintf(stderr, "Error: %s holds format 0x%04x, only ETC2, EAC and ASTC are read\n",
+			filename, h[KTX_INTERNAL_FORMAT]);
+		return FALSE;
+	}
+	if (h[KTX_DEPTH] > 1 || h[KTX_ARRAY_ELEMENTS] || h[KTX_FACES] != 1) {
+		fprintf(stderr, "Error: %s is not a plain 2D texture\n", filename);
+		return FALSE;
+	}
+	if (!h[KTX_WIDTH] || !h[KTX_HEIGHT] || h[KTX_WIDTH] > 16384 || h[KTX_HEIGHT] > 16384) {
+		fprintf(stderr, "Error: %s is %ux%u\n", filename, h[KTX_WIDTH], h[KTX_HEIGHT]);
+		return FALSE;
+	}
+	k->internal_format = h[KTX_INTERNAL_FORMAT];
+	k->width = h[KTX_WIDTH];
+	k->height = h[KTX_HEIGHT];
+	/* 0 asks the loader to generate mips, which compressed formats can't. */
+	if (h[KTX_LEVELS] > KTX_MAX_LEVELS) {
+		fprintf(stderr, "Error: %s has %u levels\n", filename, h[KTX_LEVELS]);
+		return FALSE;
+	}
+	k->levels = MAX(h[KTX_LEVELS], 1);
+	if ((MAX(k->width, k->height) >> (k->levels - 1)) == 0) {
+		fprintf(stderr, "Error: %s has %d levels for %dx%d\n", filename,
+			k->levels, k->width, k->height);
+		return FALSE;
+	}
+
+	offset = KTX_HEADER_SIZE + (size_t)h[KTX_KEY_VALUE_BYTES];
+	for (i = 0; i < k->levels; i++) {
+		size_t size = tex_image_bytes(k->internal_format, MAX(k->width >> i, 1),
+					      MAX(k->height >> i, 1));
+
+		if (offset + 4 > k->len || read_word(&k->data[offset], swap) != size ||
+		    offset + 4 + size > k->len) {
+			fprintf(stderr, "Error: %s level %d is cut short or the wrong size\n",
+				filename, i);
+			return FALSE;
+		}
+		k->level[i].offset = offset + 4;
+		k->level[i].size = size;
+		/* Blocks are 8 or 16 bytes, so the 4 byte mip padding never applies. */
+		offset += 4 + size;
+	}
+
+	return TRUE;
+}
+
+gboolean
+ktx_load(struct ktx *k, const char *filename)
+{
+	GError *error = NULL;
+	gsize len;
+
+	memset(k, 0, sizeof(*k));
+	if (!g_file_get_contents(filename, (gchar **)&k->data, &len, &error)) {
+		fprintf(stderr, "Error: %s\n", error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	k->len = len;
+	if (!parse(k, filename)) {
+		ktx_fini(k);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void
+ktx_fini(struct ktx *k)
+{
+	g_free(k->data);
+	k->data = NULL;
+}
+
+GLuint
+ktx_create_texture(const struct ktx *k)
+{
+	GLuint texture;
+	int i;
+
+	/* Immutable storage, so the levels go in with the sub-image call. */
+	texture = tex_pool_get(GL_TEXTURE_2D, k->internal_format, k->width, k->height, 1, k->levels);
+	for (i = 0; i < k->levels; i++)
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, MAX(k->width >> i, 1),
+					  MAX(k->height >> i, 1), k->internal_format,
+					  k->level[i].size, &k->data[k->level[i].offset]);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			k->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glCheckError();
+
+	return texture;
+}
@@ -0,0 +1,43 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#define KTX_MAX_LEVELS 16
+
+/*
+ * A pre-compressed 2D texture read from a KTX 1.1 container: ETC2 and
+ * EAC, core in ES 3, or ASTC LDR. Level i is level[i].size bytes at
+ * data + level[i].offset, whole blocks, ready for glCompressedTexSubImage2D.
+ */
+struct ktx {
+	GLenum internal_format;
+	int width, height, levels;
+	uint8_t *data;		/* the whole file */
+	size_t len;
+	struct {
+		size_t offset, size;
+	} level[KTX_MAX_LEVELS];
+};
+
+/* FALSE, with a message, unless filename is a 2D KTX of a known compressed format. */
+gboolean ktx_load(struct ktx *k, const char *filename);
+void ktx_fini(struct ktx *k);
+
+/* "etc2-rgb8", "astc-6x6-srgb", ...; NULL for formats this reader does not take. */
+const char *ktx_format_name(GLenum internal_format);
+/* Whether the current context samples the format: ETC2 and EAC always, ASTC with the LDR extension. */
+gboolean ktx_format_supported(GLenum internal_format);
+
+/*
+ * Pooled texture with every level uploaded, bound on the active unit,
+ * clamped and filtered (trilinear when there are mips). Need a current
+ * context that supports the format.
+ */
+GLuint ktx_create_texture(const struct ktx *k);
+
+#endif
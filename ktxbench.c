@@ -0,0 +1,238 @@
+/*
+ * Compressed texture benchmark: uploads each texture and samples it 1:1
+ * into an offscreen target, next to an RGBA8 texture of the same size,
+ * and prints the memory each takes and the cost of the upload and the
+ * draw, one CSV (or JSON) row per texture. KTX files are measured as
+ * they are; without any, noise ETC2 textures stand in (every bit pattern
+ * is a valid ETC2 or EAC block, which is not true of ASTC).
+ *
+ *   ktxbench --files logo-etc2.ktx,logo-astc6x6.ktx --json
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#include "bench.h"
+#include "context.h"
+#include "ktx.h"
+#include "program.h"
+#include "texpool.h"
+
+static struct render_ctx ctx;
+
+static char *files;
+static char *sizes = "512x512,2048x2048";
+
+static GOptionEntry entries[] = {
+	{ "files", 'f', 0, G_OPTION_ARG_STRING, &files, "Comma separated KTX files", "FILE,..." },
+	{ "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes, "Comma separated noise texture sizes, without files", "WxH,..." },
+	{ NULL }
+};
+
+static const char *frag_shader_text =
+	"#version 300 es\n"
+	"precision mediump float;\n"
+	"in vec2 vTexCoord;\n"
+	"uniform sampler2D uTex;\n"
+	"out vec4 fragColor;\n"
+	"void main() {\n"
+	"  fragColor = texture(uTex, vTexCoord);\n"
+	"}\n";
+
+struct result {
+	size_t bytes;		/* every level */
+	double upload_ms;
+	double draw_ms;		/* level 0 sampled 1:1 over the target */
+	double mtexel_s;
+};
+
+struct upload {
+	const struct ktx *k;
+	GLenum internal_format;
+};
+
+/* Upload every level of k again. */
+static void
+upload(gpointer data, int n)
+{
+	const struct upload *u = data;
+	const struct ktx *k = u->k;
+	int i;
+
+	if (u->internal_format == GL_RGBA8)
+		for (i = 0; i < k->levels; i++)
+			glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, MAX(k->width >> i, 1),
+					MAX(k->height >> i, 1), GL_RGBA, GL_UNSIGNED_BYTE,
+					k->data);
+	else
+		for (i = 0; i < k->levels; i++)
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, MAX(k->width >> i, 1),
+						  MAX(k->height >> i, 1), u->internal_format,
+						  k->level[i].size, &k->data[k->level[i].offset]);
+}
+
+static void
+draw(gpointer data, int n)
+{
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+/*
+ * Measure k as it is, or as RGBA8 of the same shape when internal_format
+ * is GL_RGBA8; k->data is then only the source of the upload bytes and
+ * must be large enough for level 0 in RGBA8.
+ */
+static void
+run(const struct ktx *k, GLenum internal_format, struct result *r)
+{
+	struct upload u = { .k = k, .internal_format = internal_format };
+	GLuint texture, target;
+	int i;
+
+	r->bytes = 0;
+	for (i = 0; i < k->levels; i++)
+		r->bytes += tex_image_bytes(internal_format, MAX(k->width >> i, 1),
+					    MAX(k->height >> i, 1));
+
+	target = bench_target_get(k->width, k->height);
+
+	if (internal_format == GL_RGBA8) {
+		texture = tex_pool_get(GL_TEXTURE_2D, GL_RGBA8, k->width, k->height, 1, k->levels);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+				k->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	} else {
+		texture = ktx_create_texture(k);
+	}
+
+	r->upload_ms = bench_time(upload, &u);
+	r->draw_ms = bench_time(draw, NULL);
+	r->mtexel_s = (double)k->width * k->height / (r->draw_ms * 1000.0);
+
+	bench_target_put(target);
+	tex_pool_put(texture);
+	glCheckError();
+}
+
+static void
+print_row(const char *source, const char *format, const struct ktx *k,
+	  const struct result *r, size_t rgba_bytes)
+{
+	bench_row_begin();
+	bench_field_str("source", source);
+	bench_field_str("format", format);
+	bench_field("width", "%d", k->width);
+	bench_field("height", "%d", k->height);
+	bench_field("levels", "%d", k->levels);
+	bench_field("frames", "%d", bench_frames());
+	bench_field("kib", "%.1f", r->bytes / 1024.0);
+	bench_field("ratio", "%.3f", (double)r->bytes / rgba_bytes);
+	bench_field("upload_ms", "%.3f", r->upload_ms);
+	bench_field("draw_ms", "%.3f", r->draw_ms);
+	bench_field("mtexel_s", "%.1f", r->mtexel_s);
+	bench_row_end();
+}
+
+static uint8_t *
+noise(size_t len)
+{
+	uint8_t *data = g_malloc(len);
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] = g_random_int();
+	return data;
+}
+
+/* One row for k, then one for RGBA8 of the same shape. */
+static void
+measure(const char *source, struct ktx *k)
+{
+	struct result r, rgba;
+	struct ktx raw = *k;
+
+	if (!ktx_format_supported(k->internal_format)) {
+		fprintf(stderr, "%s: the context can't sample %s, skipped\n", source,
+			ktx_format_name(k->internal_format));
+		return;
+	}
+
+	/* Noise, so no framebuffer compression flatters the raw upload. */
+	raw.data = noise(tex_image_bytes(GL_RGBA8, k->width, k->height));
+	run(&raw, GL_RGBA8, &rgba);
+	run(k, k->internal_format, &r);
+	g_free(raw.data);
+
+	print_row(source, ktx_format_name(k->internal_format), k, &r, rgba.bytes);
+	print_row(source, "rgba8", k, &rgba, rgba.bytes);
+}
+
+/* Single level noise texture, as if read from a file. */
+static void
+noise_ktx(struct ktx *k, GLenum internal_format, int width, int height)
+{
+	memset(k, 0, sizeof(*k));
+	k->internal_format = internal_format;
+	k->width = width;
+	k->height = height;
+	k->levels = 1;
+	k->level[0].size = k->len = tex_image_bytes(internal_format, width, height);
+	k->data = noise(k->len);
+}
+
+int
+main(int argc, char **argv)
+{
+	static const GLenum noise_formats[] = {
+		GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC,
+	};
+	gchar **list;
+	GLuint program;
+	unsigned int f;
+	int i;
+
+	if (!bench_parse_args(&argc, &argv, entries, 100))
+		return 1;
+
+	if (!render_ctx_init_offscreen(&ctx, RENDER_API_GLES))
+		return 1;
+
+	program = program_get(fullscreen_vert_shader(GL_FALSE), frag_shader_text, NULL);
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "uTex"), 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	list = g_strsplit(files ? files : sizes, ",", -1);
+	for (i = 0; list[i]; i++) {
+		struct ktx k;
+		int width, height;
+
+		if (files) {
+			char *name = g_path_get_basename(list[i]);
+
+			if (!ktx_load(&k, list[i]))
+				return 1;
+			measure(name, &k);
+			ktx_fini(&k);
+			g_free(name);
+			continue;
+		}
+
+		if (sscanf(list[i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+			fprintf(stderr, "Error: bad size '%s'\n", list[i]);
+			return 1;
+		}
+		for (f = 0; f < G_N_ELEMENTS(noise_formats); f++) {
+			noise_ktx(&k, noise_formats[f], width, height);
+			measure("noise", &k);
+			ktx_fini(&k);
+		}
+	}
+	bench_finish();
+
+	g_strfreev(list);
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+
+#include "loadstats.h"
+
+static struct {
+	gint64 wall;	/* us */
+	gint64 cpu;	/* us */
+	unsigned int draws;
+} last;
+static unsigned int draws;
+
+static gint64
+cpu_time(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (gint64)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * G_USEC_PER_SEC +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static gboolean
+report(gpointer data)
+{
+	gint64 wall = g_get_monotonic_time();
+	gint64 cpu = cpu_time();
+	gdouble secs = (wall - last.wall) / (gdouble)G_USEC_PER_SEC;
+
+	(void)data;
+
+	printf("load: %.1f%% CPU, %.1f draws/s\n",
+	       100.0 * (cpu - last.cpu) / (wall - last.wall),
+	       (draws - last.draws) / secs);
+
+	last.wall = wall;
+	last.cpu = cpu;
+	last.draws = draws;
+
+	return G_SOURCE_CONTINUE;
+}
+
+void
+loadstats_start(unsigned int period)
+{
+	last.wall = g_get_monotonic_time();
+	last.cpu = cpu_time();
+	last.draws = draws;
+	g_timeout_add_seconds(period, report, NULL);
+}
+
+void
+loadstats_draw(void)
+{
+	draws++;
+}
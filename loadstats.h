@@ -0,0 +1,12 @@
+#ifndef LOADSTATS_H
+#define LOADSTATS_H
+
+/*
+ * Idle cost report: every period seconds, print the process CPU
+ * utilization (user + system time over wall time) and the number of
+ * frames drawn. An idle viewer should show 0 draws and ~0% CPU.
+ */
+void loadstats_start(unsigned int period);
+void loadstats_draw(void);
+
+#endif
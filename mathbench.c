@@ -0,0 +1,209 @@
+/*
+ * Instance math benchmark: the per frame CPU work of gtkegles' batch
+ * and instanced modes for count instances, done with libm cosf and
+ * sinf and scalar loops as the demo used to, and with vecmath, plus a
+ * view matrix times every model matrix. Prints the time per frame and
+ * the largest difference from the libm results, one CSV (or JSON) row
+ * per operation and implementation. No GL involved.
+ *
+ *   mathbench --count 1000000 --json
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "bench.h"
+#include "vecmath.h"
+
+static int count = 1000000;
+
+static GOptionEntry entries[] = {
+	{ "count", 'c', 0, G_OPTION_ARG_INT, &count, "Instances updated per frame", "N" },
+	{ NULL }
+};
+
+/* gtkegles' triangle. */
+static const float points[3][2] = {
+	{ -0.5, -0.5 },
+	{  0.5, -0.5 },
+	{  0,    0.5 }
+};
+
+enum op { OP_MATRICES, OP_VERTICES, OP_MULTIPLY };
+
+static const char *const op_names[] = { "matrices", "vertices", "multiply" };
+
+static struct vm_instance *inst;
+static float *models, *out;
+static float view[16];
+
+static void
+libm_matrix(const struct vm_instance *in, float angle, float *m)
+{
+	float a = angle + in->phase;
+	float c = cosf(a) * in->scale, s = sinf(a) * in->scale;
+
+	memset(m, 0, 16 * sizeof(float));
+	m[0] = c;
+	m[2] = s;
+	m[5] = in->scale;
+	m[8] = -s;
+	m[10] = c;
+	m[12] = in->x;
+	m[13] = in->y;
+	m[15] = 1;
+}
+
+static void
+libm_multiply(float *r, const float *a, const float *b)
+{
+	int i, j, k;
+
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 4; j++) {
+			float sum = 0;
+
+			for (k = 0; k < 4; k++)
+				sum += a[k * 4 + j] * b[i * 4 + k];
+			r[i * 4 + j] = sum;
+		}
+}
+
+/* One frame of op into out, the libm way or with vecmath. */
+static void
+run(enum op op, gboolean simd, float angle)
+{
+	float m[16];
+	int i, v;
+
+	switch (op) {
+	case OP_MATRICES:
+		if (simd) {
+			vm_model_matrices(inst, count, angle, out);
+			break;
+		}
+		for (i = 0; i < count; i++)
+			libm_matrix(&inst[i], angle, &out[i * 16]);
+		break;
+
+	case OP_VERTICES:
+		if (simd) {
+			vm_model_vertices(inst, count, angle, &points[0][0], 3, out);
+			break;
+		}
+		for (i = 0; i < count; i++) {
+			libm_matrix(&inst[i], angle, m);
+			for (v = 0; v < 3; v++) {
+				float *o = &out[(i * 3 + v) * 3];
+
+				o[0] = m[0] * points[v][0] + m[4] * points[v][1] + m[12];
+				o[1] = m[1] * points[v][0] + m[5] * points[v][1] + m[13];
+				o[2] = m[2] * points[v][0] + m[6] * points[v][1] + m[14];
+			}
+		}
+		break;
+
+	case OP_MULTIPLY:
+		for (i = 0; i < count; i++) {
+			if (simd)
+				mat4_multiply(&out[i * 16], view, &models[i * 16]);
+			else
+				libm_multiply(&out[i * 16], view, &models[i * 16]);
+		}
+		break;
+	}
+}
+
+struct pass {
+	enum op op;
+	gboolean simd;
+};
+
+static void
+frame(gpointer data, int n)
+{
+	const struct pass *p = data;
+
+	run(p->op, p->simd, 1.0f);
+}
+
+static size_t
+out_floats(enum op op)
+{
+	return (size_t)count * (op == OP_VERTICES ? 9 : 16);
+}
+
+static void
+print_row(enum op op, gboolean simd, double ms, double error)
+{
+	bench_row_begin();
+	bench_field_str("op", op_names[op]);
+	bench_field_str("impl", simd ? "vecmath" : "libm");
+	bench_field("count", "%d", count);
+	bench_field("frames", "%d", bench_frames());
+	bench_field("ms", "%.3f", ms);
+	bench_field("minstances_s", "%.1f", ms > 0 ? count / (ms * 1000.0) : 0);
+	bench_field("max_error", "%.2e", error);
+	bench_row_end();
+}
+
+int
+main(int argc, char **argv)
+{
+	float *reference;
+	unsigned int op;
+	int i, simd, cols;
+
+	if (!bench_parse_args(&argc, &argv, entries, 20))
+		return 1;
+	if (count <= 0) {
+		fprintf(stderr, "Error: bad instance count %d\n", count);
+		return 1;
+	}
+
+	/*
+	 * gtkegles' grid and phases, at unit scale so that the error column
+	 * is that of the sines and cosines.
+	 */
+	cols = ceil(sqrt(count));
+	inst = g_new(struct vm_instance, count);
+	for (i = 0; i < count; i++) {
+		inst[i].x = -1 + (i % cols + 0.5f) * 2.0f / cols;
+		inst[i].y = 1 - (i / cols + 0.5f) * 2.0f / cols;
+		inst[i].scale = 1;
+		inst[i].phase = fmodf(i * 0.05f, 2 * M_PI);
+	}
+	models = g_new(float, 16 * (size_t)count);
+	vm_model_matrices(inst, count, 0.3f, models);
+	mat4_rotation_y(view, 0.7f);
+	view[12] = 0.25f;
+
+	out = g_new(float, 16 * (size_t)count);
+	reference = g_new(float, 16 * (size_t)count);
+
+	for (op = 0; op < G_N_ELEMENTS(op_names); op++) {
+		run(op, FALSE, 1.0f);
+		memcpy(reference, out, out_floats(op) * sizeof(float));
+
+		for (simd = 0; simd < 2; simd++) {
+			struct pass p = { .op = op, .simd = simd };
+			double worst = 0, ms;
+
+			ms = bench_time(frame, &p);
+			for (i = 0; i < (int)out_floats(op); i++)
+				worst = MAX(worst, fabs(out[i] - reference[i]));
+			print_row(op, simd, ms, worst);
+		}
+	}
+	bench_finish();
+
+	g_free(inst);
+	g_free(models);
+	g_free(out);
+	g_free(reference);
+
+	return 0;
+}
@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "font.h"
+#include "glstate.h"
+#include "overlay.h"
+#include "program.h"
+#include "texpool.h"
+
+static const char *vert_shader_text =
+	"#version 300 es				\n"
+	"layout(location = 0) in vec2 in_Position;	\n"
+	"layout(location = 1) in vec2 in_TexCoord;	\n"
+	"layout(location = 2) in vec4 in_Color;		\n"
+	"						\n"
+	"uniform vec2 uScale;				\n"
+	"						\n"
+	"out vec2 vTexCoord;				\n"
+	"out vec4 vColor;				\n"
+	"						\n"
+	"void main() {					\n"
+	"  gl_Position = vec4(in_Position * uScale + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+	"  vTexCoord = in_TexCoord;			\n"
+	"  vColor = in_Color;				\n"
+	"}						\n";
+
+/* Coverage from the atlas scales the premultiplied color. */
+static const char *frag_shader_text =
+	"#version 300 es				\n"
+	"precision mediump float;			\n"
+	"						\n"
+	"in vec2 vTexCoord;				\n"
+	"in vec4 vColor;				\n"
+	"						\n"
+	"uniform sampler2D uAtlas;			\n"
+	"						\n"
+	"out vec4 fragColor;				\n"
+	"						\n"
+	"void main() {					\n"
+	"  fragColor = vColor * texture(uAtlas, vTexCoord).x;\n"
+	"}						\n";
+
+static struct {
+	GLuint texture;
+	int users;
+} atlas;
+
+GLuint
+overlay_atlas_get(void)
+{
+	uint8_t texels[FONT_ATLAS_WIDTH * FONT_ATLAS_HEIGHT];
+
+	if (atlas.users++)
+		return atlas.texture;
+
+	font_atlas(texels);
+	gl_state_active_texture(GL_TEXTURE0 + OVERLAY_UNIT);
+	atlas.texture = tex_pool_get(GL_TEXTURE_2D, GL_R8, FONT_ATLAS_WIDTH, FONT_ATLAS_HEIGHT, 1, 1);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, FONT_ATLAS_WIDTH, FONT_ATLAS_HEIGHT,
+			GL_RED, GL_UNSIGNED_BYTE, texels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	gl_state_active_texture(GL_TEXTURE0);
+
+	return atlas.texture;
+}
+
+void
+overlay_atlas_put(void)
+{
+	if (--atlas.users)
+		return;
+	tex_pool_put(atlas.texture);
+	atlas.texture = 0;
+}
+
+const char *
+overlay_frag_shader(void)
+{
+	return frag_shader_text;
+}
+
+void
+overlay_init(struct overlay *o)
+{
+	GLushort *indices;
+	GLuint program;
+	int i;
+
+	memset(o, 0, sizeof(*o));
+	program = gl_state_program();
+
+	o->program = program_get(vert_shader_text, frag_shader_text, NULL);
+	gl_state_use_program(o->program);
+	gl_state_uniform1i(glGetUniformLocation(o->program, "uAtlas"), OVERLAY_UNIT);
+	o->uscale = glGetUniformLocation(o->program, "uScale");
+	overlay_atlas_get();
+
+	/* Two triangles per quad, the same for every batch. */
+	indices = g_new(GLushort, OVERLAY_MAX_QUADS * 6);
+	for (i = 0; i < OVERLAY_MAX_QUADS; i++) {
+		GLushort *q = &indices[i * 6];
+
+		q[0] = q[3] = i * 4;
+		q[1] = i * 4 + 1;
+		q[2] = q[4] = i * 4 + 2;
+		q[5] = i * 4 + 3;
+	}
+
+	glGenVertexArrays(1, &o->vao);
+	gl_state_bind_vertex_array(o->vao);
+	glGenBuffers(1, &o->vbo);
+	glGenBuffers(1, &o->ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, o->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, OVERLAY_MAX_QUADS * 6 * sizeof(GLushort),
+		     indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, o->vbo);
+	glVertexAttribPointer(0, 2, GL_SHORT, GL_FALSE, sizeof(struct overlay_vertex),
+			      (void *)G_STRUCT_OFFSET(struct overlay_vertex, x));
+	glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(struct overlay_vertex),
+			      (void *)G_STRUCT_OFFSET(struct overlay_vertex, u));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(struct overlay_vertex),
+			      (void *)G_STRUCT_OFFSET(struct overlay_vertex, color));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	gl_state_bind_vertex_array(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	gl_state_use_program(program);
+	glCheckError();
+
+	g_free(indices);
+}
+
+void
+overlay_fini(struct overlay *o)
+{
+	glDeleteVertexArrays(1, &o->vao);
+	glDeleteBuffers(1, &o->vbo);
+	glDeleteBuffers(1, &o->ibo);
+	overlay_atlas_put();
+	g_free(o->verts);
+	o->verts = NULL;
+}
+
+void
+overlay_begin(struct overlay *o, int width, int height)
+{
+	o->begun = g_get_monotonic_time();
+	o->width = width;
+	o->height = height;
+	o->nquads = 0;
+}
+
+static void
+add_quad(void *data, const struct overlay_quad *quad)
+{
+	struct overlay *o = data;
+	struct overlay_vertex *q;
+	int i;
+
+	if (o->nquads == OVERLAY_MAX_QUADS) {
+		if (!o->dropped)
+			fprintf(stderr, "overlay: more than %d quads in a frame, dropping the rest\n",
+				OVERLAY_MAX_QUADS);
+		o->dropped = TRUE;
+		return;
+	}
+	if (o->nquads == o->capacity) {
+		o->capacity = MAX(o->capacity * 2, 256);
+		o->verts = g_renew(struct overlay_vertex, o->verts, o->capacity * 4);
+	}
+
+	q = &o->verts[o->nquads++ * 4];
+	for (i = 0; i < 4; i++) {
+		int right = i == 1 || i == 2, bottom = i >= 2;
+
+		q[i].x = quad->x + right * quad->w;
+		q[i].y = quad->y + bottom * quad->h;
+		q[i].u = (quad->u + right * quad->uw) * 65535 / FONT_ATLAS_WIDTH;
+		q[i].v = (quad->v + bottom * quad->vh) * 65535 / FONT_ATLAS_HEIGHT;
+		memcpy(q[i].color, quad->color, 4);
+	}
+}
+
+/* Pixel rect x, y, w, h showing atlas texels u, v, uw, vh. */
+static void
+emit_quad(overlay_emit_fn emit, void *data, int x, int y, int w, int h,
+	  int u, int v, int uw, int vh, uint32_t color)
+{
+	GLubyte a = color & 0xff;
+	struct overlay_quad q = {
+		x, y, w, h, u, v, uw, vh,
+		{ (color >> 24) * a / 255, (color >> 16 & 0xff) * a / 255,
+		  (color >> 8 & 0xff) * a / 255, a },
+	};
+
+	emit(data, &q);
+}
+
+void
+overlay_layout_rect(overlay_emit_fn emit, void *data, int x, int y, int w, int h,
+		    uint32_t color)
+{
+	int u, v;
+
+	/* The middle of the solid cell, so no filtering reaches its edge. */
+	font_atlas_cell(FONT_ATLAS_SOLID, &u, &v);
+	emit_quad(emit, data, x, y, w, h, u + FONT_CELL_WIDTH / 2, v + FONT_CELL_HEIGHT / 2,
+		  0, 0, color);
+}
+
+int
+overlay_layout_text(overlay_emit_fn emit, void *data, int x, int y, int scale,
+		    const char *text, uint32_t color)
+{
+	int x0 = x, u, v;
+
+	for (; *text; text++, x += FONT_CELL_WIDTH * scale) {
+		if (*text == ' ')
+			continue;
+		font_atlas_cell((unsigned char)*text, &u, &v);
+		emit_quad(emit, data, x, y, FONT_WIDTH * scale, FONT_HEIGHT * scale, u, v,
+			  FONT_WIDTH, FONT_HEIGHT, color);
+	}
+
+	return x - x0;
+}
+
+void
+overlay_upload(GLuint buffer, size_t capacity, const void *data, size_t size)
+{
+	/* Orphan last frame's storage rather than wait for draws still reading it. */
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_STREAM_DRAW);
+	if (size)
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void
+overlay_rect(struct overlay *o, int x, int y, int w, int h, uint32_t color)
+{
+	overlay_layout_rect(add_quad, o, x, y, w, h, color);
+}
+
+void
+overlay_border(struct overlay *o, int x, int y, int w, int h, int thickness, uint32_t color)
+{
+	overlay_rect(o, x, y, w, thickness, color);
+	overlay_rect(o, x, y + h - thickness, w, thickness, color);
+	overlay_rect(o, x, y + thickness, thickness, h - 2 * thickness, color);
+	overlay_rect(o, x + w - thickness, y + thickness, thickness, h - 2 * thickness, color);
+}
+
+int
+overlay_text(struct overlay *o, int x, int y, int scale, const char *text, uint32_t color)
+{
+	return overlay_layout_text(add_quad, o, x, y, scale, text, color);
+}
+
+void
+overlay_end(struct overlay *o)
+{
+	gint64 now;
+
+	overlay_upload(o->vbo, o->capacity * 4 * sizeof(struct overlay_vertex), o->verts,
+		       o->nquads * 4 * sizeof(struct overlay_vertex));
+
+	now = g_get_monotonic_time();
+	o->stats.cpu += now - o->begun;
+	o->stats.quads += o->nquads;
+	o->stats.frames++;
+	if (!o->stats.since)
+		o->stats.since = now;
+	if (now - o->stats.since >= G_USEC_PER_SEC) {
+		printf("overlay: %llu quads, %.1f draw calls, %.3f ms CPU per frame, %u frames\n",
+		       (unsigned long long)(o->stats.quads / o->stats.frames),
+		       (double)o->stats.draws / o->stats.frames,
+		       o->stats.cpu / 1000.0 / o->stats.frames, o->stats.frames);
+		memset(&o->stats, 0, sizeof(o->stats));
+		o->stats.since = now;
+	}
+}
+
+void
+overlay_draw(struct overlay *o)
+{
+	gint64 start = g_get_monotonic_time();
+	GLuint program, vao;
+
+	if (!o->nquads)
+		return;
+
+	program = gl_state_program();
+	vao = gl_state_vertex_array();
+
+	gl_state_use_program(o->program);
+	glUniform2f(o->uscale, 2.0f / o->width, -2.0f / o->height);
+	gl_state_bind_vertex_array(o->vao);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDrawElements(GL_TRIANGLES, o->nquads * 6, GL_UNSIGNED_SHORT, 0);
+	glDisable(GL_BLEND);
+
+	gl_state_bind_vertex_array(vao);
+	gl_state_use_program(program);
+
+	o->stats.draws++;
+	o->stats.cpu += g_get_monotonic_time() - start;
+}
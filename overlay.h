@@ -0,0 +1,93 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+/* Texture unit the glyph atlas stays bound on, for the HUD too. */
+#define OVERLAY_UNIT 5
+/* Quads one batch holds, as many as 16 bit indices reach. */
+#define OVERLAY_MAX_QUADS 16384
+
+/*
+ * On-screen display layer: the rectangles and text of a frame are
+ * collected between overlay_begin() and overlay_end() into one dynamic
+ * vertex buffer, all sampling the font atlas (rectangles its solid
+ * cell), and drawn in a single call with premultiplied alpha over what
+ * the framebuffer already holds. Coordinates are window pixels, top left
+ * origin; colors are 0xRRGGBBAA with straight alpha.
+ */
+struct overlay_vertex {
+	GLshort x, y;
+	GLushort u, v;
+	GLubyte color[4];	/* premultiplied */
+};
+
+struct overlay {
+	GLuint program, vao, vbo, ibo;
+	GLint uscale;
+	struct overlay_vertex *verts;
+	int nquads, capacity;
+	int width, height;
+	gboolean dropped;	/* warned about a full batch */
+	gint64 begun;
+
+	struct {
+		uint64_t quads;
+		unsigned int draws, frames;
+		gint64 cpu;	/* us building, uploading and issuing */
+		gint64 since;
+	} stats;
+};
+
+/* Need a current context. Leaves the current program alone. */
+void overlay_init(struct overlay *o);
+void overlay_fini(struct overlay *o);
+
+/* Start the batch for a width x height target. */
+void overlay_begin(struct overlay *o, int width, int height);
+void overlay_rect(struct overlay *o, int x, int y, int w, int h, uint32_t color);
+/* Outline of thickness pixels inside the rectangle. */
+void overlay_border(struct overlay *o, int x, int y, int w, int h, int thickness, uint32_t color);
+/* Text at scale times the font size; returns the width drawn, in pixels. */
+int overlay_text(struct overlay *o, int x, int y, int scale, const char *text, uint32_t color);
+/* Upload the batch; it is drawn until the next overlay_begin(). */
+void overlay_end(struct overlay *o);
+
+/*
+ * Draw the batch into the bound framebuffer, in one call. Can be called
+ * more than once per batch, e.g. once per scissor rect. The program and
+ * vertex array are restored, blending is left off.
+ */
+void overlay_draw(struct overlay *o);
+
+/*
+ * Pieces the HUD draws with too. The font atlas is one texture on
+ * OVERLAY_UNIT, uploaded by the first get and deleted by the last put;
+ * overlay_frag_shader() colors a fragment from it. The layout turns
+ * rectangles and text into quads, each handed to emit.
+ */
+struct overlay_quad {
+	int x, y, w, h;		/* window pixels */
+	int u, v, uw, vh;	/* atlas texels */
+	GLubyte color[4];	/* premultiplied */
+};
+
+typedef void (*overlay_emit_fn)(void *data, const struct overlay_quad *q);
+
+GLuint overlay_atlas_get(void);
+void overlay_atlas_put(void);
+const char *overlay_frag_shader(void);
+
+void overlay_layout_rect(overlay_emit_fn emit, void *data, int x, int y, int w, int h,
+			 uint32_t color);
+/* Returns the width laid out, in pixels. */
+int overlay_layout_text(overlay_emit_fn emit, void *data, int x, int y, int scale,
+			const char *text, uint32_t color);
+
+/* Replace the contents of a stream vertex buffer of capacity bytes. */
+void overlay_upload(GLuint buffer, size_t capacity, const void *data, size_t size);
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GLES3/gl3.h>
+
+#include "present.h"
+
+void
+presenter_init(struct presenter *p, const struct damage *d)
+{
+	memset(p, 0, sizeof(*p));
+	damage_init(&p->present, d->width, d->height, d->tile);
+	damage_history_init(&p->history, d);
+	p->runs = malloc(d->cols * d->rows * 4 * sizeof(int));
+	p->rects = malloc(d->cols * d->rows * 4 * sizeof(EGLint));
+	p->radius = 1;
+}
+
+void
+presenter_fini(struct presenter *p)
+{
+	damage_fini(&p->present);
+	damage_history_fini(&p->history);
+	free(p->runs);
+	free(p->rects);
+}
+
+/*
+ * Turn the dirty runs of d into window rects (x, y, w, h, origin at the
+ * bottom left as EGL and glScissor want them). Rects are grown by the
+ * filter radius so that filtering across tile edges is covered.
+ */
+static int
+window_rects(struct presenter *p, const struct damage *d, int ww, int wh)
+{
+	int pad = p->radius * ((ww + d->width - 1) / d->width) + 1;
+	int i, n = damage_runs(d, p->runs);
+
+	for (i = 0; i < n; i++) {
+		int *run = &p->runs[i * 4];
+		int x0 = (int64_t)run[0] * d->tile * ww / d->width - pad;
+		int x1 = ((int64_t)(run[0] + run[2]) * d->tile * ww + d->width - 1) / d->width + pad;
+		int y0 = (int64_t)run[1] * d->tile * wh / d->height - pad;
+		int y1 = ((int64_t)(run[1] + run[3]) * d->tile * wh + d->height - 1) / d->height + pad;
+
+		x0 = MAX(x0, 0);
+		y0 = MAX(y0, 0);
+		x1 = MIN(x1, ww);
+		y1 = MIN(y1, wh);
+
+		p->rects[i * 4 + 0] = x0;
+		p->rects[i * 4 + 1] = wh - y1;
+		p->rects[i * 4 + 2] = x1 - x0;
+		p->rects[i * 4 + 3] = y1 - y0;
+	}
+
+	return n;
+}
+
+gboolean
+presenter_present(struct presenter *p, struct render_ctx *ctx,
+		  struct damage *damage, int ww, int wh,
+		  void (*draw)(void *data), void *data)
+{
+	EGLint age = 0;
+	int i, n;
+	gint64 now;
+
+	if (ww != p->last_ww || wh != p->last_wh) {
+		damage_all(damage);
+		p->last_ww = ww;
+		p->last_wh = wh;
+	}
+	if (!damage->ndirty)
+		return FALSE;
+
+	damage_history_push(&p->history, damage);
+	if (ctx->has_buffer_age)
+		eglQuerySurface(ctx->display, ctx->surface, EGL_BUFFER_AGE_EXT, &age);
+	if (!damage_history_accumulate(&p->history, &p->present, age))
+		damage_all(&p->present);
+
+	if (p->present.ndirty == p->present.cols * p->present.rows) {
+		draw(data);
+	} else {
+		n = window_rects(p, &p->present, ww, wh);
+		glEnable(GL_SCISSOR_TEST);
+		for (i = 0; i < n; i++) {
+			glScissor(p->rects[i * 4], p->rects[i * 4 + 1],
+				  p->rects[i * 4 + 2], p->rects[i * 4 + 3]);
+			draw(data);
+		}
+		glDisable(GL_SCISSOR_TEST);
+	}
+
+	if (ctx->swap_buffers_with_damage && damage->ndirty < damage->cols * damage->rows) {
+		n = window_rects(p, damage, ww, wh);
+		ctx->swap_buffers_with_damage(ctx->display, ctx->surface, p->rects, n);
+		for (i = 0; i < n; i++)
+			p->stats.presented += (uint64_t)p->rects[i * 4 + 2] * p->rects[i * 4 + 3];
+	} else {
+		render_ctx_swap(ctx);
+		p->stats.presented += (uint64_t)ww * wh;
+	}
+
+	p->stats.full += (uint64_t)ww * wh;
+	p->stats.frames++;
+	now = g_get_monotonic_time();
+	if (now - p->stats.since >= G_USEC_PER_SEC) {
+		printf("present: %llu of %llu pixels per frame (%.1f%%), %d frames\n",
+		       (unsigned long long)(p->stats.presented / p->stats.frames),
+		       (unsigned long long)(p->stats.full / p->stats.frames),
+		       100.0 * p->stats.presented / p->stats.full,
+		       p->stats.frames);
+		memset(&p->stats, 0, sizeof(p->stats));
+		p->stats.since = now;
+	}
+
+	return TRUE;
+}
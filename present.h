@@ -0,0 +1,43 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <stdint.h>
+
+#include "context.h"
+#include "damage.h"
+
+/*
+ * Damage-aware presentation of a frame stretched over the whole window:
+ * with EGL_EXT_buffer_age only tiles changed since the back buffer was
+ * last used are repainted, and eglSwapBuffersWithDamage tells the
+ * compositor which parts of the window changed in this frame.
+ */
+struct presenter {
+	struct damage present;	/* damage to repaint in the current back buffer */
+	struct damage_history history;
+	int *runs;
+	EGLint *rects;
+	int last_ww, last_wh;
+	int radius;		/* frame pixels each side the draw's filter reads, 1 by default */
+
+	struct {
+		uint64_t presented;	/* window pixels handed to the compositor */
+		uint64_t full;
+		int frames;
+		gint64 since;
+	} stats;
+};
+
+void presenter_init(struct presenter *p, const struct damage *d);
+void presenter_fini(struct presenter *p);
+
+/*
+ * damage holds the tiles changed by this frame; a resize turns it into
+ * full damage. draw paints the frame and is called once per scissor
+ * rect. Returns FALSE, without drawing or swapping, when nothing changed.
+ */
+gboolean presenter_present(struct presenter *p, struct render_ctx *ctx,
+			   struct damage *damage, int ww, int wh,
+			   void (*draw)(void *data), void *data);
+
+#endif
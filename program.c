@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "program.h"
+
+#define PROGRAM_CACHE_SIZE 32
+
+static struct {
+	const char *vert, *frag;
+	const char *const *varyings;
+	GLuint program;
+} cache[PROGRAM_CACHE_SIZE];
+static int ncached;
+
+#define FULLSCREEN_VERT(texcoord) \
+	"#version 300 es				\n" \
+	"out vec2 vTexCoord;				\n" \
+	"						\n" \
+	"void main() {					\n" \
+	"  vec2 p = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0;\n" \
+	"  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);	\n" \
+	"  vTexCoord = " texcoord ";			\n" \
+	"}						\n"
+
+static const char *fullscreen_text = FULLSCREEN_VERT("p");
+static const char *fullscreen_flip_text = FULLSCREEN_VERT("vec2(p.x, 1.0 - p.y)");
+
+GLenum glCheckError_(const char *file, int line)
+{
+    GLenum errorCode;
+    while ((errorCode = glGetError()) != GL_NO_ERROR) {
+	printf("error 0x%x | %s:%d\n", errorCode, file, line);
+    }
+    return errorCode;
+}
+
+GLuint
+create_shader(const char *source, GLenum shader_type)
+{
+	GLuint shader;
+	GLint status;
+
+	shader = glCreateShader(shader_type);
+	glShaderSource(shader, 1, (const char **) &source, NULL);
+	glCompileShader(shader);
+
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status) {
+		char log[1000];
+		GLsizei len;
+		glGetShaderInfoLog(shader, 1000, &len, log);
+		fprintf(stderr, "Error: compiling %s: %.*s\n",
+			shader_type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+			len, log);
+		exit(1);
+	}
+
+	return shader;
+}
+
+GLuint
+program_get_feedback(const char *vert_text, const char *frag_text, const char *const *attribs,
+		     const char *const *varyings)
+{
+	GLuint frag, vert;
+	GLuint program;
+	GLint status;
+	int i;
+
+	for (i = 0; i < ncached; i++)
+		if (cache[i].vert == vert_text && cache[i].frag == frag_text &&
+		    cache[i].varyings == varyings)
+			return cache[i].program;
+
+	frag = create_shader(frag_text, GL_FRAGMENT_SHADER);
+	vert = create_shader(vert_text, GL_VERTEX_SHADER);
+
+	program = glCreateProgram();
+	glAttachShader(program, frag);
+	glAttachShader(program, vert);
+	for (i = 0; attribs && attribs[i]; i++)
+		glBindAttribLocation(program, i, attribs[i]);
+	for (i = 0; varyings && varyings[i]; i++)
+		;
+	if (i)
+		glTransformFeedbackVaryings(program, i, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(program);
+
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status) {
+		char log[1000];
+		GLsizei len;
+		glGetProgramInfoLog(program, 1000, &len, log);
+		fprintf(stderr, "Error: linking:\n%.*s\n", len, log);
+		exit(1);
+	}
+
+	glDetachShader(program, frag);
+	glDetachShader(program, vert);
+	glDeleteShader(frag);
+	glDeleteShader(vert);
+
+	if (ncached < PROGRAM_CACHE_SIZE) {
+		cache[ncached].vert = vert_text;
+		cache[ncached].frag = frag_text;
+		cache[ncached].varyings = varyings;
+		cache[ncached].program = program;
+		ncached++;
+	}
+
+	return program;
+}
+
+GLuint
+program_get(const char *vert_text, const char *frag_text, const char *const *attribs)
+{
+	return program_get_feedback(vert_text, frag_text, attribs, NULL);
+}
+
+const char *
+fullscreen_vert_shader(GLboolean flip)
+{
+	return flip ? fullscreen_flip_text : fullscreen_text;
+}
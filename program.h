@@ -0,0 +1,38 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+/*
+ * Desktop GL demos include glcorearb.h first; the shader sources carry
+ * their own #version, so the same calls serve both APIs.
+ */
+#ifndef __gl_glcorearb_h_
+#include <GLES3/gl3.h>
+#endif
+
+GLenum glCheckError_(const char *file, int line);
+#define glCheckError() glCheckError_(__FILE__, __LINE__)
+
+GLuint create_shader(const char *source, GLenum shader_type);
+
+/*
+ * Program cache: each (vertex, fragment) source pair is compiled and
+ * linked once per process, and later calls return the same program.
+ * attribs is a NULL terminated list of attribute names bound to
+ * locations 0, 1, ... before linking, or NULL.
+ */
+GLuint program_get(const char *vert, const char *frag, const char *const *attribs);
+/*
+ * The same, with the NULL terminated varyings captured by transform
+ * feedback, interleaved.
+ */
+GLuint program_get_feedback(const char *vert, const char *frag, const char *const *attribs,
+			    const char *const *varyings);
+
+/*
+ * Vertex shader of a fullscreen pass, glDrawArrays(GL_TRIANGLES, 0, 3)
+ * with no vertex buffer: one triangle over the viewport, vTexCoord 0, 0
+ * at the bottom left corner, or flipped, at the top left.
+ */
+const char *fullscreen_vert_shader(GLboolean flip);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Scaling kernel benchmark: draws an NV12 frame into an offscreen target
+ * of another size with every kernel and prints the cost per frame and
+ * the texture fetches per target pixel, one CSV (or JSON) row per
+ * kernel and size pair.
+ *
+ *   scalebench --sizes 1920x1080:3840x2160,3840x2160:1280x720 --json
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#include "bench.h"
+#include "context.h"
+#include "framesource.h"
+#include "program.h"
+#include "scaler.h"
+#include "texpool.h"
+#include "texstream.h"
+
+static struct render_ctx ctx;
+static GLuint bilinear_program;
+
+static char *sizes = "1280x720:1920x1080,1920x1080:3840x2160,3840x2160:1920x1080,1920x1080:640x360";
+static char *kernel_names;
+
+static GOptionEntry entries[] = {
+	{ "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes, "Comma separated source:target sizes", "WxH:WxH,..." },
+	{ "kernels", 'k', 0, G_OPTION_ARG_STRING, &kernel_names, "Comma separated kernels, all by default", "LIST" },
+	{ NULL }
+};
+
+/* The viewer's one pass path: bilinear luma and chroma, no siting. */
+static const char *frag_shader_text =
+	"#version 300 es\n"
+	"precision mediump float;\n"
+	"in vec2 vTexCoord;\n"
+	"uniform sampler2D uTexY;\n"
+	"uniform sampler2D uTexUV;\n"
+	"out vec4 fragColor;\n"
+	"void main() {\n"
+	"  float y = texture(uTexY, vTexCoord).x;\n"
+	"  vec2 uv = texture(uTexUV, vTexCoord).xy - 0.5;\n"
+	"  fragColor = vec4(y + 1.13983*uv.y, y - 0.39465*uv.x - 0.58060*uv.y,\n"
+	"                   y + 2.03211*uv.x, 1.0);\n"
+	"}\n";
+
+struct result {
+	double ms;		/* GPU done to GPU done, per frame */
+	double mpix_s;		/* target pixels */
+	double fetches;		/* texels fetched per target pixel */
+};
+
+/* Taps of one pass along an axis going from n to m texels. */
+static int
+taps(int radius, int n, int m)
+{
+	return 2 * (int)ceil(radius * MAX((double)n / m, 1.0));
+}
+
+static double
+fetches(enum scale_kernel kernel, int sw, int sh, int dw, int dh)
+{
+	int radius = scale_kernel_radius(kernel);
+	int cw = (sw + 1) / 2, ch = (sh + 1) / 2;
+	double h, v;
+
+	/* Bilinear is one filtered fetch per plane, four texels each. */
+	if (kernel == SCALE_BILINEAR)
+		return 8.0;
+
+	h = (double)dw * sh * taps(radius, sw, dw) + (double)dw * ch * taps(radius, cw, dw);
+	v = (double)dw * dh * (taps(radius, sh, dh) + taps(radius, ch, dh));
+	return (h + v) / ((double)dw * dh);
+}
+
+struct pass {
+	enum scale_kernel kernel;
+	struct scaler scaler;
+	const struct tex_stream *planes;
+	int dw, dh;
+};
+
+/* Every frame is new: the horizontal pass runs in full each time. */
+static void
+draw(gpointer data, int n)
+{
+	struct pass *p = data;
+
+	if (p->kernel == SCALE_BILINEAR) {
+		glUseProgram(bilinear_program);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		return;
+	}
+	scaler_prepare(&p->scaler, p->planes->planes[0].texture, p->planes->planes[1].texture,
+		       p->planes->width, p->planes->height, p->dw, NULL);
+	scaler_draw(&p->scaler, p->dh);
+}
+
+static void
+run(enum scale_kernel kernel, const struct tex_stream *planes, int dw, int dh,
+    struct result *r)
+{
+	struct pass p = { .kernel = kernel, .planes = planes, .dw = dw, .dh = dh };
+
+	if (kernel != SCALE_BILINEAR)
+		scaler_init(&p.scaler, kernel, CHROMA_SITING_LEFT);
+
+	r->ms = bench_time(draw, &p);
+	r->mpix_s = (double)dw * dh / (r->ms * 1000.0);
+	r->fetches = fetches(kernel, planes->width, planes->height, dw, dh);
+
+	if (kernel != SCALE_BILINEAR)
+		scaler_fini(&p.scaler);
+	glCheckError();
+}
+
+static void
+print_row(const char *kernel, int sw, int sh, int dw, int dh, const struct result *r)
+{
+	bench_row_begin();
+	bench_field_str("kernel", kernel);
+	bench_field("src_width", "%d", sw);
+	bench_field("src_height", "%d", sh);
+	bench_field("dst_width", "%d", dw);
+	bench_field("dst_height", "%d", dh);
+	bench_field("frames", "%d", bench_frames());
+	bench_field("ms", "%.3f", r->ms);
+	bench_field("mpix_s", "%.1f", r->mpix_s);
+	bench_field("fetches", "%.1f", r->fetches);
+	bench_row_end();
+}
+
+/* Mark the kernels named in the comma separated list, every one without it. */
+static gboolean
+select_kernels(const char *list, gboolean *selected)
+{
+	enum scale_kernel kernel;
+	gchar **names;
+	int i;
+
+	for (i = 0; i <= SCALE_LANCZOS3; i++)
+		selected[i] = !list;
+	if (!list)
+		return TRUE;
+
+	names = g_strsplit(list, ",", -1);
+	for (i = 0; names[i]; i++) {
+		if (!scale_kernel_from_name(names[i], &kernel)) {
+			g_strfreev(names);
+			return FALSE;
+		}
+		selected[kernel] = TRUE;
+	}
+	g_strfreev(names);
+
+	return TRUE;
+}
+
+/* Upload one noise frame into the plane textures of s, on units 0 and 1. */
+static void
+load_frame(struct tex_stream *s)
+{
+	struct frame_source *source = frame_source_new("noise", s, NULL, NULL);
+	const uint8_t *frame = frame_source_get(source, 0);
+	int i;
+
+	tex_stream_create_textures(s);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (i = 0; i < s->nplanes; i++) {
+		const struct tex_plane *p = &s->planes[i];
+
+		glActiveTexture(GL_TEXTURE0 + i);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, p->pitch / p->bpp);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p->width, p->height, p->format,
+				GL_UNSIGNED_BYTE, &frame[p->offset]);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	frame_source_release(source, frame);
+	frame_source_destroy(source);
+}
+
+int
+main(int argc, char **argv)
+{
+	gboolean selected[SCALE_LANCZOS3 + 1];
+	gchar **size_list;
+	int s;
+	unsigned int k;
+
+	if (!bench_parse_args(&argc, &argv, entries, 100) ||
+	    !select_kernels(kernel_names, selected))
+		return 1;
+
+	if (!render_ctx_init_offscreen(&ctx, RENDER_API_GLES))
+		return 1;
+
+	bilinear_program = program_get(fullscreen_vert_shader(GL_TRUE), frag_shader_text, NULL);
+	glUseProgram(bilinear_program);
+	glUniform1i(glGetUniformLocation(bilinear_program, "uTexY"), 0);
+	glUniform1i(glGetUniformLocation(bilinear_program, "uTexUV"), 1);
+
+	size_list = g_strsplit(sizes, ",", -1);
+	for (s = 0; size_list[s]; s++) {
+		struct tex_stream planes;
+		int sw, sh, dw, dh;
+		GLuint target;
+
+		if (sscanf(size_list[s], "%dx%d:%dx%d", &sw, &sh, &dw, &dh) != 4 ||
+		    dw <= 0 || dh <= 0) {
+			fprintf(stderr, "Error: bad size pair '%s'\n", size_list[s]);
+			return 1;
+		}
+		if (!tex_stream_init(&planes, TEX_FORMAT_NV12, sw, sh, NULL, NULL, 64))
+			return 1;
+		load_frame(&planes);
+
+		target = bench_target_get(dw, dh);
+
+		for (k = 0; k <= SCALE_LANCZOS3; k++) {
+			struct result r;
+
+			if (!selected[k])
+				continue;
+			run(k, &planes, dw, dh, &r);
+			print_row(scale_kernel_name(k), sw, sh, dw, dh, &r);
+		}
+
+		bench_target_put(target);
+		tex_stream_fini(&planes);
+	}
+	bench_finish();
+
+	g_strfreev(size_list);
+
+	return 0;
+}
@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <GLES3/gl3.h>
+
+#include "context.h"
+#include "glstate.h"
+#include "program.h"
+#include "scaler.h"
+#include "texpool.h"
+
+#define HEADER \
+	"#version 300 es				\n" \
+	"precision highp float;				\n" \
+	"precision highp int;				\n" \
+	"						\n" \
+	"in vec2 vTexCoord;				\n" \
+	"out vec4 fragColor;				\n" \
+	"						\n"
+
+#define TENT \
+	"#define RADIUS 1.0				\n" \
+	"float weight(float x) {			\n" \
+	"  return max(1.0 - abs(x), 0.0);		\n" \
+	"}						\n"
+
+/* Keys cubic with a = -0.5. */
+#define CATMULL_ROM \
+	"#define RADIUS 2.0				\n" \
+	"float weight(float x) {			\n" \
+	"  x = abs(x);					\n" \
+	"  if (x < 1.0)					\n" \
+	"    return (1.5 * x - 2.5) * x * x + 1.0;	\n" \
+	"  if (x < 2.0)					\n" \
+	"    return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;\n" \
+	"  return 0.0;					\n" \
+	"}						\n"
+
+#define LANCZOS(a) \
+	"#define RADIUS " #a ".0			\n" \
+	"float sinc(float x) {				\n" \
+	"  x *= 3.14159265;				\n" \
+	"  return abs(x) < 1e-4 ? 1.0 : sin(x) / x;	\n" \
+	"}						\n" \
+	"float weight(float x) {			\n" \
+	"  return abs(x) < RADIUS ? sinc(x) * sinc(x / RADIUS) : 0.0;\n" \
+	"}						\n"
+
+/*
+ * Filter plane t along axis at pos, in texels of that axis, in texel row
+ * or column other of the other axis. Edges clamp; the weights are
+ * normalised so a stretched or truncated kernel keeps flat areas flat.
+ */
+#define RESAMPLE \
+	"vec4 resample(sampler2D t, int axis, float pos, int other, float stretch) {\n" \
+	"  int n = textureSize(t, 0)[axis];		\n" \
+	"  float c = pos - 0.5;				\n" \
+	"  float base = floor(c);			\n" \
+	"  float f = c - base;				\n" \
+	"  int taps = int(ceil(RADIUS * stretch));	\n" \
+	"  vec4 sum = vec4(0.0);			\n" \
+	"  float wsum = 0.0;				\n" \
+	"  for (int i = 1 - taps; i <= taps; i++) {	\n" \
+	"    float w = weight((float(i) - f) / stretch);\n" \
+	"    int k = clamp(int(base) + i, 0, n - 1);	\n" \
+	"    ivec2 p = axis == 0 ? ivec2(k, other) : ivec2(other, k);\n" \
+	"    sum += w * texelFetch(t, p, 0);		\n" \
+	"    wsum += w;					\n" \
+	"  }						\n" \
+	"  return sum / wsum;				\n" \
+	"}						\n"
+
+/* Intermediate row n is source row n, so the row is the fragment's own. */
+#define HORIZONTAL \
+	"uniform sampler2D uTex;			\n" \
+	"uniform float uStretch;			\n" \
+	"uniform float uShift;				\n" \
+	"						\n" \
+	"void main() {					\n" \
+	"  float pos = vTexCoord.x * float(textureSize(uTex, 0).x) + uShift;\n" \
+	"  fragColor = resample(uTex, 0, pos, int(gl_FragCoord.y), uStretch);\n" \
+	"}						\n"
+
+/* The intermediates are window wide, so the column is the fragment's own. */
+#define VERTICAL \
+	"uniform sampler2D uTexY;			\n" \
+	"uniform sampler2D uTexUV;			\n" \
+	"uniform vec2 uStretch;				\n" \
+	"uniform float uShift;				\n" \
+	"						\n" \
+	"void main() {					\n" \
+	"  int x = int(gl_FragCoord.x);			\n" \
+	"  float ty = vTexCoord.y * float(textureSize(uTexY, 0).y);\n" \
+	"  float tuv = vTexCoord.y * float(textureSize(uTexUV, 0).y) + uShift;\n" \
+	"  float y = resample(uTexY, 1, ty, x, uStretch.x).x;\n" \
+	"  vec2 uv = resample(uTexUV, 1, tuv, x, uStretch.y).xy - 0.5;\n" \
+	"  fragColor = vec4(y + 1.13983*uv.y,		\n" \
+	"                   y - 0.39465*uv.x - 0.58060*uv.y,\n" \
+	"                   y + 2.03211*uv.x, 1.0);	\n" \
+	"}						\n"
+
+static const struct {
+	const char *name;
+	int radius;		/* in texels of the plane filtered */
+	const char *hfrag, *vfrag;
+} kernels[] = {
+	[SCALE_BILINEAR] = { "bilinear", 1, NULL, NULL },
+	[SCALE_TENT] = { "tent", 1,
+		HEADER TENT RESAMPLE HORIZONTAL, HEADER TENT RESAMPLE VERTICAL },
+	[SCALE_CATMULL_ROM] = { "catmull-rom", 2,
+		HEADER CATMULL_ROM RESAMPLE HORIZONTAL, HEADER CATMULL_ROM RESAMPLE VERTICAL },
+	[SCALE_LANCZOS2] = { "lanczos2", 2,
+		HEADER LANCZOS(2) RESAMPLE HORIZONTAL, HEADER LANCZOS(2) RESAMPLE VERTICAL },
+	[SCALE_LANCZOS3] = { "lanczos3", 3,
+		HEADER LANCZOS(3) RESAMPLE HORIZONTAL, HEADER LANCZOS(3) RESAMPLE VERTICAL },
+};
+
+static const char *const siting_names[] = {
+	[CHROMA_SITING_LEFT] = "left",
+	[CHROMA_SITING_CENTER] = "center",
+	[CHROMA_SITING_TOPLEFT] = "topleft",
+};
+
+gboolean
+scale_kernel_from_name(const char *name, enum scale_kernel *kernel)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(kernels); i++) {
+		if (!strcmp(name, kernels[i].name)) {
+			*kernel = i;
+			return TRUE;
+		}
+	}
+	fprintf(stderr, "Error: unknown scaling kernel '%s', try bilinear, tent, "
+		"catmull-rom, lanczos2 or lanczos3\n", name);
+	return FALSE;
+}
+
+gboolean
+chroma_siting_from_name(const char *name, enum chroma_siting *siting)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(siting_names); i++) {
+		if (!strcmp(name, siting_names[i])) {
+			*siting = i;
+			return TRUE;
+		}
+	}
+	fprintf(stderr, "Error: unknown chroma siting '%s', try left, center or topleft\n", name);
+	return FALSE;
+}
+
+const char *
+scale_kernel_name(enum scale_kernel kernel)
+{
+	return kernels[kernel].name;
+}
+
+int
+scale_kernel_radius(enum scale_kernel kernel)
+{
+	return kernels[kernel].radius;
+}
+
+void
+scaler_init(struct scaler *s, enum scale_kernel kernel, enum chroma_siting siting)
+{
+	const char *ext = (const char *)glGetString(GL_EXTENSIONS);
+	GLuint program;
+
+	memset(s, 0, sizeof(*s));
+	s->kernel = kernel;
+	s->siting = siting;
+
+	if (has_extension(ext, "GL_EXT_color_buffer_half_float") ||
+	    has_extension(ext, "GL_EXT_color_buffer_float")) {
+		s->luma_format = GL_R16F;
+		s->chroma_format = GL_RG16F;
+	} else {
+		s->luma_format = GL_R8;
+		s->chroma_format = GL_RG8;
+	}
+
+	program = s->hprogram = program_get(fullscreen_vert_shader(GL_TRUE), kernels[kernel].hfrag, NULL);
+	s->hu.tex = glGetUniformLocation(program, "uTex");
+	s->hu.stretch = glGetUniformLocation(program, "uStretch");
+	s->hu.shift = glGetUniformLocation(program, "uShift");
+
+	program = s->vprogram = program_get(fullscreen_vert_shader(GL_TRUE), kernels[kernel].vfrag, NULL);
+	gl_state_use_program(program);
+	gl_state_uniform1i(glGetUniformLocation(program, "uTexY"), 2);
+	gl_state_uniform1i(glGetUniformLocation(program, "uTexUV"), 3);
+	s->vu.stretch = glGetUniformLocation(program, "uStretch");
+	s->vu.shift = glGetUniformLocation(program, "uShift");
+	glCheckError();
+}
+
+void
+scaler_fini(struct scaler *s)
+{
+	if (s->luma)
+		tex_pool_put(s->luma);
+	if (s->chroma)
+		tex_pool_put(s->chroma);
+	s->luma = s->chroma = 0;
+}
+
+int
+scaler_radius(const struct scaler *s)
+{
+	return 2 * scale_kernel_radius(s->kernel);
+}
+
+static gboolean
+row_dirty(const struct damage *d, int row)
+{
+	int c;
+
+	if (!d)
+		return TRUE;
+	for (c = 0; c < d->cols; c++)
+		if (d->dirty[row * d->cols + c])
+			return TRUE;
+	return FALSE;
+}
+
+/* Horizontal pass of one plane into rows y0 to y1 of its intermediate. */
+static void
+filter_rows(struct scaler *s, GLuint dst, GLuint src, int src_w, int y0, int y1, float shift)
+{
+	gl_state_bind_framebuffer(tex_pool_framebuffer(dst));
+	gl_state_bind_texture(GL_TEXTURE_2D, src);
+	gl_state_uniform1f(s->hu.stretch, MAX((float)src_w / s->dst_w, 1.0f));
+	gl_state_uniform1f(s->hu.shift, shift);
+	glScissor(0, y0, s->dst_w, y1 - y0);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+void
+scaler_prepare(struct scaler *s, GLuint tex_y, GLuint tex_uv,
+	       int src_w, int src_h, int dst_w, const struct damage *damage)
+{
+	int cw = (src_w + 1) / 2, ch = (src_h + 1) / 2;
+	float shift = s->siting == CHROMA_SITING_CENTER ? 0.0f : 0.25f;
+	GLint viewport[4];
+	GLuint prev;
+	int rows, tile, y0, y1;
+
+	if (src_w != s->src_w || src_h != s->src_h || dst_w != s->dst_w) {
+		scaler_fini(s);
+		s->src_w = src_w;
+		s->src_h = src_h;
+		s->dst_w = dst_w;
+		damage = NULL;
+	}
+	rows = damage ? damage->rows : 1;
+	tile = damage ? damage->tile : src_h;
+
+	prev = gl_state_framebuffer();
+	gl_state_get_viewport(viewport);
+
+	gl_state_active_texture(GL_TEXTURE2);
+	if (!s->luma) {
+		s->luma = tex_pool_get(GL_TEXTURE_2D, s->luma_format, dst_w, src_h, 1, 1);
+		s->chroma = tex_pool_get(GL_TEXTURE_2D, s->chroma_format, dst_w, ch, 1, 1);
+	}
+
+	gl_state_use_program(s->hprogram);
+	gl_state_uniform1i(s->hu.tex, 2);
+	glEnable(GL_SCISSOR_TEST);
+
+	/* Bands of tile rows with anything dirty, or every row. */
+	for (y0 = 0; y0 < rows; y0 = y1) {
+		for (; y0 < rows && !row_dirty(damage, y0); y0++)
+			;
+		for (y1 = y0; y1 < rows && row_dirty(damage, y1); y1++)
+			;
+		if (y0 == y1)
+			break;
+
+		gl_state_viewport(0, 0, dst_w, src_h);
+		filter_rows(s, s->luma, tex_y, src_w, y0 * tile, MIN(y1 * tile, src_h), 0.0f);
+		gl_state_viewport(0, 0, dst_w, ch);
+		filter_rows(s, s->chroma, tex_uv, cw, y0 * tile / 2, MIN((y1 * tile + 1) / 2, ch), shift);
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	gl_state_bind_framebuffer(prev);
+	gl_state_viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	gl_state_active_texture(GL_TEXTURE0);
+	glCheckError();
+}
+
+void
+scaler_draw(struct scaler *s, int dst_h)
+{
+	gl_state_use_program(s->vprogram);
+	gl_state_active_texture(GL_TEXTURE2);
+	gl_state_bind_texture(GL_TEXTURE_2D, s->luma);
+	gl_state_active_texture(GL_TEXTURE3);
+	gl_state_bind_texture(GL_TEXTURE_2D, s->chroma);
+	gl_state_active_texture(GL_TEXTURE0);
+
+	glUniform2f(s->vu.stretch, MAX((float)s->src_h / dst_h, 1.0f),
+		    MAX((float)((s->src_h + 1) / 2) / dst_h, 1.0f));
+	gl_state_uniform1f(s->vu.shift, s->siting == CHROMA_SITING_TOPLEFT ? 0.25f : 0.0f);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+}
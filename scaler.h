@@ -0,0 +1,77 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#include "damage.h"
+
+enum scale_kernel {
+	SCALE_BILINEAR,		/* one pass, the texture unit's own filter */
+	SCALE_TENT,		/* separable linear, chroma siting aware */
+	SCALE_CATMULL_ROM,
+	SCALE_LANCZOS2,
+	SCALE_LANCZOS3,
+};
+
+/* Where 4:2:0 chroma samples sit against the luma grid. */
+enum chroma_siting {
+	CHROMA_SITING_LEFT,	/* cosited with even luma columns, MPEG-2 and H.264 default */
+	CHROMA_SITING_CENTER,	/* between the luma samples, JPEG and MPEG-1 */
+	CHROMA_SITING_TOPLEFT,	/* cosited in both directions, BT.2020 UHD */
+};
+
+/*
+ * Separable NV12 scaler: a horizontal pass filters each plane into an
+ * intermediate that is already window wide but keeps the source rows,
+ * then a vertical pass filters those, converts to RGB and draws. Two
+ * passes of 2r taps instead of one of (2r)^2; minification stretches the
+ * kernel so it still covers every source texel. Intermediates are half
+ * float when the context can render to it, so ringing below black or
+ * above white survives until the final sum.
+ */
+struct scaler {
+	enum scale_kernel kernel;
+	enum chroma_siting siting;
+	GLenum luma_format, chroma_format;
+	GLuint luma, chroma;	/* pooled intermediates, 0 until the first prepare */
+	int src_w, src_h, dst_w;
+	GLuint hprogram, vprogram;
+	struct {
+		GLint tex, stretch, shift;
+	} hu;
+	struct {
+		GLint stretch, shift;
+	} vu;
+};
+
+gboolean scale_kernel_from_name(const char *name, enum scale_kernel *kernel);
+gboolean chroma_siting_from_name(const char *name, enum chroma_siting *siting);
+const char *scale_kernel_name(enum scale_kernel kernel);
+/* Texels each side the kernel reads when magnifying. */
+int scale_kernel_radius(enum scale_kernel kernel);
+
+/* Need a current context. kernel must not be SCALE_BILINEAR. */
+void scaler_init(struct scaler *s, enum scale_kernel kernel, enum chroma_siting siting);
+void scaler_fini(struct scaler *s);
+
+/* Luma texels on each side a window pixel's filter reaches, chroma included. */
+int scaler_radius(const struct scaler *s);
+
+/*
+ * Horizontal pass from the R8 and RG8 planes tex_y and tex_uv of a
+ * src_w x src_h frame to a window dst_w pixels wide. With damage, and
+ * intermediates of the same shape, only the rows of dirty tiles are
+ * filtered again. The framebuffer binding and viewport are restored.
+ */
+void scaler_prepare(struct scaler *s, GLuint tex_y, GLuint tex_uv,
+		    int src_w, int src_h, int dst_w, const struct damage *damage);
+
+/*
+ * Vertical pass into the bound framebuffer, dst_h pixels high. The
+ * viewport must start at 0, 0 and be as wide as the dst_w prepared.
+ * Uses texture units 2 and 3.
+ */
+void scaler_draw(struct scaler *s, int dst_h);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include "context.h"
+#include "program.h"
+#include "staging.h"
+
+#define STAGING_FLAGS (GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT)
+
+static PFNGLBUFFERSTORAGEEXTPROC buffer_storage;
+
+gboolean
+staging_supported(void)
+{
+	if (!has_extension((const char *)glGetString(GL_EXTENSIONS), "GL_EXT_buffer_storage"))
+		return FALSE;
+	if (!buffer_storage)
+		buffer_storage = (PFNGLBUFFERSTORAGEEXTPROC)eglGetProcAddress("glBufferStorageEXT");
+
+	return buffer_storage != NULL;
+}
+
+gboolean
+staging_init(struct staging *st, size_t size)
+{
+	memset(st, 0, sizeof(*st));
+	if (!staging_supported())
+		return FALSE;
+
+	st->size = size;
+	glGenBuffers(1, &st->buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->buffer);
+	buffer_storage(GL_PIXEL_UNPACK_BUFFER, size, NULL, STAGING_FLAGS);
+	st->map = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, STAGING_FLAGS);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glCheckError();
+
+	if (!st->map) {
+		fprintf(stderr, "Error: cannot map a %zu byte staging buffer\n", size);
+		glDeleteBuffers(1, &st->buffer);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Wait for the oldest n batches; the GPU finishes them in order. */
+static void
+retire(struct staging *st, int n)
+{
+	GLsync fence = st->batches[(st->first + n - 1) % STAGING_MAX_FENCES].fence;
+	GLenum status;
+	int i;
+
+	status = glClientWaitSync(fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		gint64 start = g_get_monotonic_time();
+
+		do
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+		while (status == GL_TIMEOUT_EXPIRED);
+		st->stats.waits++;
+		st->stats.waited += g_get_monotonic_time() - start;
+	}
+
+	for (i = 0; i < n; i++) {
+		glDeleteSync(st->batches[st->first].fence);
+		st->first = (st->first + 1) % STAGING_MAX_FENCES;
+		st->nbatches--;
+	}
+}
+
+void
+staging_fini(struct staging *st)
+{
+	if (!st->map)
+		return;
+	staging_fence(st);
+	if (st->nbatches)
+		retire(st, st->nbatches);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, st->buffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &st->buffer);
+	st->map = NULL;
+}
+
+static gboolean
+overlaps(const struct staging *st, size_t start, size_t len, size_t a, size_t b)
+{
+	size_t end = start + len;
+
+	if (a < MIN(end, st->size) && start < b)
+		return TRUE;
+	return end > st->size && a < end - st->size;
+}
+
+ptrdiff_t
+staging_alloc(struct staging *st, size_t len)
+{
+	size_t offset = st->head, skip = 0;
+	int i, last = -1;
+
+	if (len > st->size)
+		return -1;
+	if (offset + len > st->size) {
+		skip = st->size - offset;
+		offset = 0;
+	}
+
+	/* The open batch would catch up with its own start. */
+	if (st->batch_len + skip + len > st->size)
+		staging_fence(st);
+
+	for (i = 0; i < st->nbatches; i++) {
+		int b = (st->first + i) % STAGING_MAX_FENCES;
+
+		if (overlaps(st, st->batches[b].start, st->batches[b].len, offset, offset + len))
+			last = i;
+	}
+	if (last >= 0)
+		retire(st, last + 1);
+
+	st->head = offset + len;
+	st->batch_len += skip + len;
+
+	return offset;
+}
+
+void
+staging_fence(struct staging *st)
+{
+	int b;
+
+	if (!st->batch_len)
+		return;
+	if (st->nbatches == STAGING_MAX_FENCES)
+		retire(st, 1);
+
+	b = (st->first + st->nbatches++) % STAGING_MAX_FENCES;
+	st->batches[b].start = st->batch_start;
+	st->batches[b].len = st->batch_len;
+	st->batches[b].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	st->batch_start = st->head;
+	st->batch_len = 0;
+}
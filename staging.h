@@ -0,0 +1,54 @@
+#ifndef STAGING_H
+#define STAGING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#define STAGING_MAX_FENCES 16
+
+/*
+ * Staging ring: one pixel unpack buffer made with glBufferStorageEXT and
+ * mapped persistent and coherent for its whole life, so there is no
+ * map/unmap per frame. Space is handed out front to back; each batch of
+ * uploads is closed with a fence, and a range is only written again once
+ * the fence of the batch that used it has signalled.
+ */
+struct staging {
+	GLuint buffer;
+	uint8_t *map;
+	size_t size;
+	size_t head;		/* next free byte */
+
+	/* Ranges still read by the GPU; a range may wrap past the end. */
+	struct {
+		size_t start, len;
+		GLsync fence;
+	} batches[STAGING_MAX_FENCES];
+	int first, nbatches;
+	size_t batch_start, batch_len;	/* batch not fenced yet */
+
+	struct {
+		unsigned int waits;
+		gint64 waited;	/* us */
+	} stats;
+};
+
+/* TRUE if the current context has GL_EXT_buffer_storage. */
+gboolean staging_supported(void);
+
+gboolean staging_init(struct staging *st, size_t size);
+void staging_fini(struct staging *st);
+
+/*
+ * Reserve len bytes, waiting for the GPU if they are still being read.
+ * Returns the offset into the buffer, or -1 if len can never fit.
+ */
+ptrdiff_t staging_alloc(struct staging *st, size_t len);
+
+/* Close the batch: everything allocated so far is read by commands issued so far. */
+void staging_fence(struct staging *st);
+
+#endif
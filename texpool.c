@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include "glstate.h"
+#include "program.h"
+#include "texpool.h"
+
+#define TEX_POOL_SIZE 64
+
+static struct tex_entry {
+	GLenum target, internal_format;
+	int width, height, depth, levels;
+	GLuint texture;
+	GLuint fbo;		/* 0 until asked for */
+	size_t bytes;
+	gboolean in_use;
+	guint64 last_use;
+} pool[TEX_POOL_SIZE];
+static int npooled;
+static size_t budget = TEX_POOL_BUDGET;
+static size_t total;		/* bytes held by the pool, in use or idle */
+static guint64 use_clock;
+
+static struct {
+	unsigned int hits, allocations, evictions;
+} stats;
+
+/* Bytes per texel of the sized formats the demos use. */
+static int
+format_bytes(GLenum internal_format)
+{
+	switch (internal_format) {
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_R16_EXT:
+		return 2;
+	case GL_RGB8:
+		return 3;
+	case GL_RGBA16F:
+	case GL_RGBA16_EXT:
+	case GL_RG32F:
+		return 8;
+	case GL_RGBA32F:
+		return 16;
+	default:		/* RGBA8, RGB10_A2, RG16F, R32F, ... */
+		return 4;
+	}
+}
+
+/* Block footprint of the compressed formats, FALSE for the others. */
+static gboolean
+format_block(GLenum internal_format, int *bw, int *bh, int *bytes)
+{
+	/* ASTC block sizes in enum order, the sRGB set mirrors the linear one. */
+	static const unsigned char astc[][2] = {
+		{ 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+		{ 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 },
+	};
+
+	switch (internal_format) {
+	case GL_COMPRESSED_R11_EAC:
+	case GL_COMPRESSED_SIGNED_R11_EAC:
+	case GL_COMPRESSED_RGB8_ETC2:
+	case GL_COMPRESSED_SRGB8_ETC2:
+	case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+	case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+		*bw = *bh = 4;
+		*bytes = 8;
+		return TRUE;
+	case GL_COMPRESSED_RG11_EAC:
+	case GL_COMPRESSED_SIGNED_RG11_EAC:
+	case GL_COMPRESSED_RGBA8_ETC2_EAC:
+	case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+		*bw = *bh = 4;
+		*bytes = 16;
+		return TRUE;
+	}
+	if (internal_format >= GL_COMPRESSED_RGBA_ASTC_4x4_KHR &&
+	    internal_format <= GL_COMPRESSED_RGBA_ASTC_12x12_KHR)
+		internal_format -= GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+	else if (internal_format >= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR &&
+		 internal_format <= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_12x12_KHR)
+		internal_format -= GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR;
+	else
+		return FALSE;
+	*bw = astc[internal_format][0];
+	*bh = astc[internal_format][1];
+	*bytes = 16;
+	return TRUE;
+}
+
+size_t
+tex_image_bytes(GLenum internal_format, int width, int height)
+{
+	int bw, bh, bytes;
+
+	if (!format_block(internal_format, &bw, &bh, &bytes))
+		return (size_t)width * height * format_bytes(internal_format);
+	return (size_t)((width + bw - 1) / bw) * ((height + bh - 1) / bh) * bytes;
+}
+
+static size_t
+storage_bytes(GLenum internal_format, int width, int height, int depth, int levels)
+{
+	size_t bytes = 0;
+	int i;
+
+	for (i = 0; i < levels; i++)
+		bytes += tex_image_bytes(internal_format, MAX(width >> i, 1),
+					 MAX(height >> i, 1)) * depth;
+	return bytes;
+}
+
+static void
+report(const char *what, const struct tex_entry *e)
+{
+	fprintf(stderr, "texpool: %s 0x%04x %dx%dx%d, %u hits, %u allocations, %u evictions, %.1f of %.1f MiB\n",
+		what, e->internal_format, e->width, e->height, e->depth,
+		stats.hits, stats.allocations, stats.evictions,
+		total / 1048576.0, budget / 1048576.0);
+}
+
+static void
+evict(int i)
+{
+	struct tex_entry *e = &pool[i];
+
+	stats.evictions++;
+	total -= e->bytes;
+	report("evicted", e);
+	if (e->fbo) {
+		gl_state_forget_framebuffer(e->fbo);
+		glDeleteFramebuffers(1, &e->fbo);
+	}
+	gl_state_forget_texture(e->texture);
+	glDeleteTextures(1, &e->texture);
+	pool[i] = pool[--npooled];
+}
+
+/* Drop idle textures, oldest first, until the pool fits in the budget. */
+static void
+trim(size_t limit)
+{
+	while (total > limit) {
+		int i, lru = -1;
+
+		for (i = 0; i < npooled; i++)
+			if (!pool[i].in_use && (lru < 0 || pool[i].last_use < pool[lru].last_use))
+				lru = i;
+		if (lru < 0)
+			return;
+		evict(lru);
+	}
+}
+
+void
+tex_pool_set_budget(size_t bytes)
+{
+	budget = bytes;
+	trim(budget);
+}
+
+GLuint
+tex_pool_get(GLenum target, GLenum internal_format, int width, int height,
+	     int depth, int levels)
+{
+	struct tex_entry *e;
+	GLuint texture;
+	size_t bytes;
+	int i;
+
+	for (i = 0; i < npooled; i++) {
+		e = &pool[i];
+		if (!e->in_use && e->target == target && e->internal_format == internal_format &&
+		    e->width == width && e->height == height && e->depth == depth &&
+		    e->levels == levels) {
+			e->in_use = TRUE;
+			e->last_use = ++use_clock;
+			stats.hits++;
+			gl_state_bind_texture(target, e->texture);
+			return e->texture;
+		}
+	}
+
+	/* Make room first, so the driver can reuse what is freed. */
+	bytes = storage_bytes(internal_format, width, height, depth, levels);
+	trim(budget > bytes ? budget - bytes : 0);
+	if (npooled == TEX_POOL_SIZE)
+		trim(0);
+
+	glGenTextures(1, &texture);
+	gl_state_bind_texture(target, texture);
+	if (target == GL_TEXTURE_2D)
+		glTexStorage2D(target, levels, internal_format, width, height);
+	else
+		glTexStorage3D(target, levels, internal_format, width, height, depth);
+	glCheckError();
+
+	if (npooled == TEX_POOL_SIZE) {
+		fprintf(stderr, "Warning: texture pool full, texture %u not recycled\n", texture);
+		return texture;
+	}
+
+	e = &pool[npooled++];
+	*e = (struct tex_entry){
+		.target = target,
+		.internal_format = internal_format,
+		.width = width,
+		.height = height,
+		.depth = depth,
+		.levels = levels,
+		.texture = texture,
+		.bytes = bytes,
+		.in_use = TRUE,
+		.last_use = ++use_clock,
+	};
+	total += bytes;
+	stats.allocations++;
+	report("allocated", e);
+
+	return texture;
+}
+
+static struct tex_entry *
+find(GLuint texture)
+{
+	int i;
+
+	for (i = 0; i < npooled; i++)
+		if (pool[i].texture == texture)
+			return &pool[i];
+	return NULL;
+}
+
+void
+tex_pool_put(GLuint texture)
+{
+	struct tex_entry *e;
+
+	if (!texture)
+		return;
+	e = find(texture);
+	if (!e) {
+		gl_state_forget_texture(texture);
+		glDeleteTextures(1, &texture);
+		return;
+	}
+	e->in_use = FALSE;
+	e->last_use = ++use_clock;
+	trim(budget);
+}
+
+GLuint
+tex_pool_framebuffer(GLuint texture)
+{
+	struct tex_entry *e = find(texture);
+	GLuint prev;
+
+	if (!e || e->target != GL_TEXTURE_2D) {
+		fprintf(stderr, "Error: texture %u has no pooled 2D storage\n", texture);
+		exit(1);
+	}
+	if (e->fbo)
+		return e->fbo;
+
+	prev = gl_state_framebuffer();
+	glGenFramebuffers(1, &e->fbo);
+	gl_state_bind_framebuffer(e->fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "Error: format 0x%04x is not color renderable\n", e->internal_format);
+		exit(1);
+	}
+	gl_state_bind_framebuffer(prev);
+
+	return e->fbo;
+}
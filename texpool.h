@@ -0,0 +1,42 @@
+#ifndef TEXPOOL_H
+#define TEXPOOL_H
+
+#include <stddef.h>
+
+#include <GLES3/gl3.h>
+
+/*
+ * Texture pool: textures with immutable storage, recycled by (target,
+ * internal format, width, height, depth, levels). A texture given back
+ * stays allocated, so recreating a stream of the same shape costs no
+ * driver allocation. Idle textures are evicted least recently used
+ * first once the pool holds more than the VRAM budget.
+ */
+
+/* Defaults to TEX_POOL_BUDGET bytes. */
+#define TEX_POOL_BUDGET (256u << 20)
+void tex_pool_set_budget(size_t bytes);
+
+/*
+ * A texture bound to target on the active unit. depth is the number of
+ * layers for GL_TEXTURE_2D_ARRAY and 1 for GL_TEXTURE_2D.
+ */
+GLuint tex_pool_get(GLenum target, GLenum internal_format, int width, int height,
+		    int depth, int levels);
+
+/* Give a texture back; its contents are kept but undefined to the next user. */
+void tex_pool_put(GLuint texture);
+
+/*
+ * Framebuffer with level 0 of a pooled 2D texture as color attachment 0,
+ * made on first use and kept as long as the texture.
+ */
+GLuint tex_pool_framebuffer(GLuint texture);
+
+/*
+ * Bytes of one width x height image, whole blocks for the ETC2, EAC and
+ * ASTC formats.
+ */
+size_t tex_image_bytes(GLenum internal_format, int width, int height);
+
+#endif
@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include "context.h"
+#include "glstate.h"
+#include "program.h"
+#include "texpool.h"
+#include "texstream.h"
+
+static void
+set_plane(struct tex_plane *p, GLenum internal_format, GLenum format,
+	  int bpp, int hsub, int vsub)
+{
+	p->internal_format = internal_format;
+	p->format = format;
+	p->type = GL_UNSIGNED_BYTE;
+	p->bpp = bpp;
+	p->hsub = hsub;
+	p->vsub = vsub;
+}
+
+/* Luma pitch scaled by the chroma plane's bytes per luma pixel, rounded up. */
+static int
+chroma_pitch(const struct tex_plane *luma, const struct tex_plane *p)
+{
+	int d = luma->bpp * p->hsub;
+
+	return (luma->pitch * p->bpp + d - 1) / d;
+}
+
+gboolean
+tex_stream_init(struct tex_stream *s, enum tex_format format,
+		int width, int height, const int *pitches,
+		const size_t *offsets, int tile)
+{
+	size_t end = 0;
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	s->format = format;
+	s->upload = TEX_UPLOAD_DIRECT;
+	s->width = width;
+	s->height = height;
+
+	switch (format) {
+	case TEX_FORMAT_RGBA:
+		s->nplanes = 1;
+		set_plane(&s->planes[0], GL_RGBA8, GL_RGBA, 4, 1, 1);
+		break;
+	case TEX_FORMAT_NV12:
+	case TEX_FORMAT_NV21:
+		s->nplanes = 2;
+		set_plane(&s->planes[0], GL_R8, GL_RED, 1, 1, 1);
+		set_plane(&s->planes[1], GL_RG8, GL_RG, 2, 2, 2);
+		break;
+	case TEX_FORMAT_I420:
+	case TEX_FORMAT_YV12:
+		s->nplanes = 3;
+		set_plane(&s->planes[0], GL_R8, GL_RED, 1, 1, 1);
+		set_plane(&s->planes[1], GL_R8, GL_RED, 1, 2, 2);
+		set_plane(&s->planes[2], GL_R8, GL_RED, 1, 2, 2);
+		break;
+	case TEX_FORMAT_YUYV:
+	case TEX_FORMAT_UYVY:
+		s->nplanes = 1;
+		set_plane(&s->planes[0], GL_RGBA8, GL_RGBA, 4, 2, 1);
+		break;
+	case TEX_FORMAT_P010:
+		s->nplanes = 2;
+		set_plane(&s->planes[0], GL_RG8, GL_RG, 2, 1, 1);
+		set_plane(&s->planes[1], GL_RGBA8, GL_RGBA, 4, 2, 2);
+		break;
+	}
+
+	if (width <= 0 || height <= 0 || tile < 2 || tile % 2) {
+		fprintf(stderr, "Error: bad frame size %dx%d or tile %d\n", width, height, tile);
+		return FALSE;
+	}
+
+	for (i = 0; i < s->nplanes; i++) {
+		struct tex_plane *p = &s->planes[i];
+
+		p->width = (width + p->hsub - 1) / p->hsub;
+		p->height = (height + p->vsub - 1) / p->vsub;
+		p->pitch = pitches && pitches[i] ? pitches[i] :
+			   i ? chroma_pitch(&s->planes[0], p) : p->width * p->bpp;
+		p->offset = offsets && offsets[i] ? offsets[i] : end;
+
+		if (p->pitch < p->width * p->bpp || p->pitch % p->bpp || p->offset < end) {
+			fprintf(stderr, "Error: bad layout for plane %d: %dx%d pitch %d offset %zu\n",
+				i, p->width, p->height, p->pitch, p->offset);
+			return FALSE;
+		}
+		end = p->offset + (size_t)p->pitch * p->height;
+	}
+	s->frame_size = end;
+
+	damage_init(&s->damage, width, height, tile);
+	s->runs = malloc(s->damage.cols * s->damage.rows * 4 * sizeof(int));
+
+	return TRUE;
+}
+
+void
+tex_stream_fini(struct tex_stream *s)
+{
+	int i;
+
+	for (i = 0; i < s->nplanes; i++)
+		tex_pool_put(s->planes[i].texture);
+	if (s->upload == TEX_UPLOAD_PERSISTENT)
+		staging_fini(&s->staging);
+	damage_fini(&s->damage);
+	free(s->runs);
+}
+
+gboolean
+tex_stream_use_norm16(struct tex_stream *s)
+{
+	if (s->format != TEX_FORMAT_P010 ||
+	    !has_extension((const char *)glGetString(GL_EXTENSIONS), "GL_EXT_texture_norm16"))
+		return FALSE;
+
+	/* Same bytes, little endian like the host, read as 16 bit words. */
+	set_plane(&s->planes[0], GL_R16_EXT, GL_RED, 2, 1, 1);
+	set_plane(&s->planes[1], GL_RG16_EXT, GL_RG, 4, 2, 2);
+	s->planes[0].type = s->planes[1].type = GL_UNSIGNED_SHORT;
+
+	return TRUE;
+}
+
+void
+tex_stream_create_textures(struct tex_stream *s)
+{
+	int i;
+
+	for (i = 0; i < s->nplanes; i++) {
+		struct tex_plane *p = &s->planes[i];
+
+		gl_state_active_texture(GL_TEXTURE0 + s->unit + i);
+		p->texture = tex_pool_get(GL_TEXTURE_2D, p->internal_format, p->width, p->height, 1, 1);
+
+		/* Sampler state is not part of the pool key, a recycled texture may differ. */
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glCheckError();
+
+	s->shown = NULL;
+}
+
+void
+tex_stream_bind(struct tex_stream *s, int first_unit)
+{
+	int i;
+
+	s->unit = first_unit;
+	for (i = 0; i < s->nplanes; i++) {
+		gl_state_active_texture(GL_TEXTURE0 + first_unit + i);
+		gl_state_bind_texture(GL_TEXTURE_2D, s->planes[i].texture);
+	}
+}
+
+static const char *const format_names[] = {
+	[TEX_FORMAT_RGBA] = "rgba",
+	[TEX_FORMAT_NV12] = "nv12",
+	[TEX_FORMAT_NV21] = "nv21",
+	[TEX_FORMAT_I420] = "i420",
+	[TEX_FORMAT_YV12] = "yv12",
+	[TEX_FORMAT_YUYV] = "yuyv",
+	[TEX_FORMAT_UYVY] = "uyvy",
+	[TEX_FORMAT_P010] = "p010",
+};
+
+gboolean
+tex_format_from_name(const char *name, enum tex_format *format)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(format_names); i++) {
+		if (!strcmp(name, format_names[i])) {
+			*format = i;
+			return TRUE;
+		}
+	}
+	fprintf(stderr, "Error: unknown format '%s', try rgba, nv12, nv21, i420, yv12, "
+		"yuyv, uyvy or p010\n", name);
+	return FALSE;
+}
+
+const char *
+tex_format_name(enum tex_format format)
+{
+	return format_names[format];
+}
+
+static const char *const upload_names[] = {
+	[TEX_UPLOAD_AUTO] = "auto",
+	[TEX_UPLOAD_DIRECT] = "direct",
+	[TEX_UPLOAD_PERSISTENT] = "persistent",
+};
+
+gboolean
+tex_upload_from_name(const char *name, enum tex_upload *upload)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(upload_names); i++) {
+		if (!strcmp(name, upload_names[i])) {
+			*upload = i;
+			return TRUE;
+		}
+	}
+	fprintf(stderr, "Error: unknown upload strategy '%s', try auto, direct or persistent\n", name);
+	return FALSE;
+}
+
+gboolean
+tex_stream_set_upload(struct tex_stream *s, enum tex_upload upload)
+{
+	if (s->upload == TEX_UPLOAD_PERSISTENT)
+		staging_fini(&s->staging);
+	s->upload = TEX_UPLOAD_DIRECT;
+
+	if (upload == TEX_UPLOAD_DIRECT)
+		goto out;
+
+	/*
+	 * Three frames of room: the GPU may still read two earlier frames
+	 * before a wait, and dirty runs never add up to more than a frame.
+	 */
+	if (staging_init(&s->staging, 3 * s->frame_size)) {
+		s->upload = TEX_UPLOAD_PERSISTENT;
+	} else if (upload == TEX_UPLOAD_PERSISTENT) {
+		fprintf(stderr, "Error: persistent upload needs GL_EXT_buffer_storage\n");
+		return FALSE;
+	}
+
+out:
+	printf("upload strategy: %s\n", upload_names[s->upload]);
+	return TRUE;
+}
+
+/*
+ * Copy a run into the staging ring, tightly packed, and upload it from
+ * there. Returns FALSE if it does not fit, for a direct upload instead.
+ */
+static gboolean
+upload_run_staged(struct tex_stream *s, const struct tex_plane *p, const uint8_t *src,
+		  int x, int y, int w, int h)
+{
+	size_t row = (size_t)w * p->bpp;
+	ptrdiff_t offset = staging_alloc(&s->staging, row * h);
+	uint8_t *dst;
+	int i;
+
+	if (offset < 0)
+		return FALSE;
+
+	dst = s->staging.map + offset;
+	if (row == (size_t)p->pitch) {
+		memcpy(dst, src, row * h);
+	} else {
+		for (i = 0; i < h; i++)
+			memcpy(&dst[i * row], &src[(size_t)i * p->pitch], row);
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s->staging.buffer);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, p->format, p->type,
+			(const void *)(uintptr_t)offset);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, p->pitch / p->bpp);
+
+	return TRUE;
+}
+
+/*
+ * Upload the dirty runs of one plane, one glTexSubImage2D per run.
+ * Decoders hand out planes with padded pitches; GL_UNPACK_ROW_LENGTH
+ * (in texels) lets GL skip the padding, so no CPU repack is needed.
+ */
+static void
+upload_dirty_plane(struct tex_stream *s, int index, const uint8_t *plane, int nruns)
+{
+	const struct tex_plane *p = &s->planes[index];
+	int tw = s->damage.tile / p->hsub;
+	int th = s->damage.tile / p->vsub;
+	const uint8_t *src;
+	int i;
+
+	gl_state_active_texture(GL_TEXTURE0 + s->unit + index);
+	gl_state_bind_texture(GL_TEXTURE_2D, p->texture);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, p->pitch / p->bpp);
+	for (i = 0; i < nruns; i++) {
+		int *run = &s->runs[i * 4];
+		int x = run[0] * tw;
+		int y = run[1] * th;
+		int w = MIN((run[0] + run[2]) * tw, p->width) - x;
+		int h = MIN((run[1] + run[3]) * th, p->height) - y;
+
+		if (w <= 0 || h <= 0)
+			continue;
+
+		src = &plane[(size_t)y * p->pitch + x * p->bpp];
+		if (s->upload != TEX_UPLOAD_PERSISTENT ||
+		    !upload_run_staged(s, p, src, x, y, w, h))
+			glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, p->format,
+					p->type, src);
+		s->stats.uploaded += (uint64_t)w * h * p->bpp;
+		s->uploaded_total += (uint64_t)w * h * p->bpp;
+	}
+}
+
+int
+tex_stream_update(struct tex_stream *s, const uint8_t *frame)
+{
+	gint64 now;
+	int i, nruns;
+
+	if (frame == s->shown)
+		return 0;
+
+	damage_clear(&s->damage);
+	if (!s->shown) {
+		damage_all(&s->damage);
+	} else {
+		for (i = 0; i < s->nplanes; i++) {
+			const struct tex_plane *p = &s->planes[i];
+
+			damage_diff_plane(&s->damage, &frame[p->offset], &s->shown[p->offset],
+					  p->pitch, p->width * p->bpp, p->height,
+					  s->damage.tile / p->hsub * p->bpp,
+					  s->damage.tile / p->vsub);
+		}
+	}
+	s->shown = frame;
+
+	nruns = damage_runs(&s->damage, s->runs);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (i = 0; i < s->nplanes; i++) {
+		const struct tex_plane *p = &s->planes[i];
+
+		upload_dirty_plane(s, i, &frame[p->offset], nruns);
+		s->stats.full += (uint64_t)p->width * p->height * p->bpp;
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	if (s->upload == TEX_UPLOAD_PERSISTENT)
+		staging_fence(&s->staging);
+	glCheckError();
+
+	s->stats.frames++;
+	now = g_get_monotonic_time();
+	if (now - s->stats.since >= G_USEC_PER_SEC) {
+		printf("upload: %llu of %llu bytes per frame (%.1f%%), %d frames",
+		       (unsigned long long)(s->stats.uploaded / s->stats.frames),
+		       (unsigned long long)(s->stats.full / s->stats.frames),
+		       100.0 * s->stats.uploaded / s->stats.full,
+		       s->stats.frames);
+		if (s->upload == TEX_UPLOAD_PERSISTENT)
+			printf(", %u fence waits (%.2f ms)", s->staging.stats.waits,
+			       s->staging.stats.waited / 1000.0);
+		printf("\n");
+		memset(&s->stats, 0, sizeof(s->stats));
+		memset(&s->staging.stats, 0, sizeof(s->staging.stats));
+		s->stats.since = now;
+	}
+
+	return s->damage.ndirty;
+}
+
+uint8_t *
+tex_stream_load(const struct tex_stream *s, const char *filename,
+		const uint8_t *fallback, int *nframes)
+{
+	uint8_t *frame;
+	size_t src_offset = 0;
+	int i, x, y;
+
+	if (filename) {
+		GError *error = NULL;
+		gsize len;
+
+		if (!g_file_get_contents(filename, (gchar **)&frame, &len, &error)) {
+			fprintf(stderr, "Error: %s\n", error->message);
+			exit(1);
+		}
+		if (len < s->frame_size) {
+			fprintf(stderr, "Error: %s has %zu bytes, layout needs %zu\n",
+				filename, (size_t)len, s->frame_size);
+			exit(1);
+		}
+		*nframes = len / s->frame_size;
+		return frame;
+	}
+
+	frame = g_malloc0(s->frame_size);
+	for (i = 0; i < s->nplanes; i++) {
+		const struct tex_plane *p = &s->planes[i];
+		int src_w = 512 / p->hsub, src_h = 512 / p->vsub;
+		int src_pitch = src_w * p->bpp;
+
+		for (y = 0; y < p->height; y++) {
+			uint8_t *dst = &frame[p->offset + (size_t)y * p->pitch];
+			const uint8_t *src = &fallback[src_offset + (size_t)(y % src_h) * src_pitch];
+
+			for (x = 0; x < p->width; x++)
+				memcpy(&dst[x * p->bpp], &src[(x % src_w) * p->bpp], p->bpp);
+		}
+		src_offset += (size_t)src_pitch * src_h;
+	}
+	*nframes = 1;
+
+	return frame;
+}
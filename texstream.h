@@ -0,0 +1,128 @@
+#ifndef TEXSTREAM_H
+#define TEXSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#include "damage.h"
+#include "staging.h"
+
+/*
+ * Frame formats, each uploaded as is: planar formats get a texture per
+ * plane, packed 4:2:2 one RGBA8 texture per pair of pixels, and 16 bit
+ * samples two or four 8 bit channels the shader puts back together.
+ */
+enum tex_format {
+	TEX_FORMAT_RGBA,
+	TEX_FORMAT_NV12,	/* Y, interleaved UV */
+	TEX_FORMAT_NV21,	/* Y, interleaved VU */
+	TEX_FORMAT_I420,	/* Y, U, V */
+	TEX_FORMAT_YV12,	/* Y, V, U */
+	TEX_FORMAT_YUYV,	/* Y0 U Y1 V */
+	TEX_FORMAT_UYVY,	/* U Y0 V Y1 */
+	TEX_FORMAT_P010,	/* NV12 with little endian 16 bit samples, 10 bits at the top */
+};
+
+#define TEX_MAX_PLANES 3
+
+/* How dirty runs reach the textures. */
+enum tex_upload {
+	TEX_UPLOAD_AUTO,	/* the fastest one the context supports */
+	TEX_UPLOAD_DIRECT,	/* glTexSubImage2D from client memory */
+	TEX_UPLOAD_PERSISTENT,	/* via a persistent mapped staging ring */
+};
+
+struct tex_plane {
+	GLenum internal_format, format, type;
+	int bpp;		/* bytes per texel */
+	int hsub, vsub;		/* subsampling against the frame size */
+	int width, height;	/* in texels */
+	int pitch;		/* in bytes */
+	size_t offset;		/* in bytes, from the start of the frame */
+	GLuint texture;
+};
+
+/*
+ * Texture stream: the GL side of a sequence of frames with a fixed format
+ * and layout. Each plane lives in its own immutable texture. Updates are
+ * diffed against the frame already in the textures and only dirty tiles
+ * are uploaded, straight from the padded source with
+ * GL_UNPACK_ROW_LENGTH.
+ */
+struct tex_stream {
+	enum tex_format format;
+	int width, height;
+	int nplanes;
+	struct tex_plane planes[TEX_MAX_PLANES];
+	size_t frame_size;
+	int unit;		/* plane i is bound to texture unit unit + i */
+	enum tex_upload upload;
+	struct staging staging;	/* TEX_UPLOAD_PERSISTENT only */
+
+	const uint8_t *shown;	/* frame in the textures, NULL before the first update */
+	struct damage damage;	/* tiles changed by the last update */
+	int *runs;
+	uint64_t uploaded_total;	/* bytes sent since init, for rate counters */
+
+	struct {
+		uint64_t uploaded;	/* bytes sent with glTexSubImage2D */
+		uint64_t full;		/* bytes a full-frame upload would send */
+		int frames;
+		gint64 since;
+	} stats;
+};
+
+/*
+ * Set up the layout. pitches and offsets are per plane, in bytes; 0 picks
+ * the default: a tight pitch (interleaved chroma shares the luma pitch,
+ * separate U and V planes get half of it), and planes back to back.
+ * Returns FALSE, with a message, on a bad layout.
+ */
+gboolean tex_stream_init(struct tex_stream *s, enum tex_format format,
+			 int width, int height, const int *pitches,
+			 const size_t *offsets, int tile);
+void tex_stream_fini(struct tex_stream *s);
+
+/*
+ * Keep 16 bit samples in 16 bit unorm textures (GL_EXT_texture_norm16)
+ * rather than in pairs of 8 bit channels. Call before creating the
+ * textures; FALSE, with the layout left alone, if the format has no 16
+ * bit samples or the context lacks the extension.
+ */
+gboolean tex_stream_use_norm16(struct tex_stream *s);
+
+/* Need a current context. */
+void tex_stream_create_textures(struct tex_stream *s);
+void tex_stream_bind(struct tex_stream *s, int first_unit);
+
+/*
+ * Pick the upload strategy, after tex_stream_create_textures(). Returns
+ * FALSE, with a message, if the context cannot do it.
+ */
+gboolean tex_stream_set_upload(struct tex_stream *s, enum tex_upload upload);
+
+/* Parse "rgba", "nv12", "nv21", "i420", "yv12", "yuyv", "uyvy" or "p010". */
+gboolean tex_format_from_name(const char *name, enum tex_format *format);
+const char *tex_format_name(enum tex_format format);
+
+/* Parse "auto", "direct" or "persistent". */
+gboolean tex_upload_from_name(const char *name, enum tex_upload *upload);
+
+/*
+ * Make frame the content of the textures. Returns the number of dirty
+ * tiles, 0 when frame is identical to the one shown.
+ */
+int tex_stream_update(struct tex_stream *s, const uint8_t *frame);
+
+/*
+ * Read raw frames with the stream layout from filename, or without one,
+ * tile a 512x512 tightly packed frame of the same format into a single
+ * frame. Returns the buffer, *nframes is set to the frame count.
+ */
+uint8_t *tex_stream_load(const struct tex_stream *s, const char *filename,
+			 const uint8_t *fallback, int *nframes);
+
+#endif
@@ -0,0 +1,81 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tribench.h"
+
+/* The demo triangle, in the 0..100 square. */
+static const float triangle[3][2] = {
+	{ 50, 10 },
+	{ 90, 90 },
+	{ 10, 90 },
+};
+
+static const float colors[3][3] = {
+	{ 1, 0, 0 },
+	{ 0, 1, 0 },
+	{ 0, 0, 1 },
+};
+
+void
+tri_bench_layout(int count, float *xy, float *rgb)
+{
+	int cols = ceil(sqrt(count));
+	float cell = 100.0f / cols;
+	int i, v;
+
+	for (i = 0; i < count; i++) {
+		float x = i % cols * cell, y = i / cols * cell;
+
+		for (v = 0; v < 3; v++) {
+			*xy++ = x + triangle[v][0] * cell / 100.0f;
+			*xy++ = y + triangle[v][1] * cell / 100.0f;
+			memcpy(rgb, colors[v], sizeof(colors[v]));
+			rgb += 3;
+		}
+	}
+}
+
+void
+tri_bench_init(struct tri_bench *b, const char *method, int count)
+{
+	memset(b, 0, sizeof(*b));
+	b->method = method;
+	b->count = count;
+}
+
+void
+tri_bench_begin(struct tri_bench *b)
+{
+	b->begun = g_get_monotonic_time();
+}
+
+void
+tri_bench_submitted(struct tri_bench *b)
+{
+	b->submitted = g_get_monotonic_time();
+}
+
+void
+tri_bench_end(struct tri_bench *b)
+{
+	gint64 now = g_get_monotonic_time();
+	double frame_ms;
+
+	b->stats.submit += b->submitted - b->begun;
+	b->stats.total += now - b->begun;
+	b->stats.frames++;
+	if (!b->stats.since)
+		b->stats.since = now;
+	if (now - b->stats.since < G_USEC_PER_SEC)
+		return;
+
+	frame_ms = b->stats.total / 1000.0 / b->stats.frames;
+	printf("tribench: %s, %d triangles, %.3f ms submit, %.3f ms to finish per frame, "
+	       "%.2f Mtri/s submitted, %.2f Mtri/s drawn, %u frames\n",
+	       b->method, b->count, b->stats.submit / 1000.0 / b->stats.frames, frame_ms,
+	       (double)b->count * b->stats.frames / MAX(b->stats.submit, 1),
+	       b->count / (frame_ms * 1000.0), b->stats.frames);
+	memset(&b->stats, 0, sizeof(b->stats));
+	b->stats.since = now;
+}
@@ -0,0 +1,41 @@
+#ifndef TRIBENCH_H
+#define TRIBENCH_H
+
+#include <glib.h>
+
+/* Keeps the float counts of the layout well inside an int. */
+#define TRI_BENCH_MAX_TRIANGLES 1000000
+
+/*
+ * Triangle benchmark shared by the desktop GL demos: count small copies
+ * of the demo triangle in a grid over the 0..100 square both of them
+ * draw in, so the immediate mode and the core profile demo submit the
+ * very same geometry, and the same report line every second.
+ */
+struct tri_bench {
+	const char *method;
+	int count;
+	gint64 begun, submitted;
+
+	struct {
+		unsigned int frames;
+		gint64 submit;	/* us issuing the draws */
+		gint64 total;	/* us until the GPU is done with them */
+		gint64 since;
+	} stats;
+};
+
+/* Fill xy with 3 * count positions and rgb with 3 * count colors. */
+void tri_bench_layout(int count, float *xy, float *rgb);
+
+void tri_bench_init(struct tri_bench *b, const char *method, int count);
+
+/*
+ * Bracket the draws of a frame: tri_bench_begin(), the draws,
+ * tri_bench_submitted(), glFinish(), tri_bench_end().
+ */
+void tri_bench_begin(struct tri_bench *b);
+void tri_bench_submitted(struct tri_bench *b);
+void tri_bench_end(struct tri_bench *b);
+
+#endif
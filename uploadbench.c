@@ -0,0 +1,608 @@
+/*
+ * Upload strategy benchmark: pushes the same frames through every way of
+ * getting pixels into textures, for a set of sizes and formats, and
+ * prints one CSV (or JSON) row per combination.
+ *
+ *   uploadbench --sizes 1280x720,3840x2160 --formats nv12 --json
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#ifdef HAVE_UDMABUF
+#include <linux/udmabuf.h>
+#endif
+
+#include "bench.h"
+#include "context.h"
+#include "framesource.h"
+#include "program.h"
+#include "staging.h"
+#include "texpool.h"
+#include "texstream.h"
+
+#define BENCH_RING 3		/* buffers in flight for the PBO and dma-buf rings */
+#define BENCH_FRAMES 4		/* distinct frames cycled through */
+
+#define fourcc(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | \
+			    ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+struct bench;
+
+struct strategy {
+	const char *name;
+	/* FALSE if the context cannot do it. */
+	gboolean (*init)(struct bench *b);
+	/* Leave the planes of frame bound on units 0 and 1. */
+	void (*upload)(struct bench *b, const uint8_t *frame, unsigned int n);
+	void (*fini)(struct bench *b);
+};
+
+struct bench {
+	struct tex_stream layout;	/* plane geometry only */
+	GLuint textures[TEX_MAX_PLANES];
+	GLuint pbos[BENCH_RING];
+	struct staging staging;
+	struct dma_frame {
+		int memfd, dmabuf;
+		uint8_t *map;
+		size_t size;
+		EGLImageKHR images[TEX_MAX_PLANES];
+		GLuint textures[TEX_MAX_PLANES];
+		GLsync fence;	/* after the last draw sampling it */
+	} dma[BENCH_RING];
+};
+
+static struct render_ctx ctx;
+static GLuint program;
+
+static char *sizes = "640x360,1280x720,1920x1080,3840x2160";
+static char *formats = "nv12,rgba";
+static char *strategies;
+
+static GOptionEntry entries[] = {
+	{ "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes, "Comma separated frame sizes", "WxH,..." },
+	{ "formats", 'f', 0, G_OPTION_ARG_STRING, &formats, "Comma separated formats: rgba, nv12, nv21, i420, yv12, yuyv, uyvy, p010", "LIST" },
+	{ "strategies", 0, 0, G_OPTION_ARG_STRING, &strategies, "Comma separated strategies, all by default", "LIST" },
+	{ NULL }
+};
+
+/* Touch texels all over both planes, so lazy uploads have to land. */
+static const char *frag_shader_text =
+	"#version 300 es\n"
+	"precision mediump float;\n"
+	"uniform sampler2D uTex0;\n"
+	"uniform sampler2D uTex1;\n"
+	"out vec4 color;\n"
+	"void main() {\n"
+	"  vec2 uv = gl_FragCoord.xy / 16.0;\n"
+	"  color = texture(uTex0, uv) + texture(uTex1, uv.yx);\n"
+	"}\n";
+
+static double
+thread_cpu_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void
+bind_planes(const struct bench *b, const GLuint *textures)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, textures[MIN(i, b->layout.nplanes - 1)]);
+	}
+}
+
+static void
+set_sampling(void)
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+/* Upload every plane of a frame from client memory or from a bound PBO. */
+static void
+sub_image(const struct bench *b, const GLuint *textures, const uint8_t *base)
+{
+	int i;
+
+	for (i = 0; i < b->layout.nplanes; i++) {
+		const struct tex_plane *p = &b->layout.planes[i];
+
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, p->pitch / p->bpp);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, p->width, p->height, p->format,
+				p->type, base + p->offset);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+static gboolean
+immutable_init(struct bench *b)
+{
+	int i;
+
+	for (i = 0; i < b->layout.nplanes; i++) {
+		const struct tex_plane *p = &b->layout.planes[i];
+
+		b->textures[i] = tex_pool_get(GL_TEXTURE_2D, p->internal_format,
+					      p->width, p->height, 1, 1);
+		set_sampling();
+	}
+	return TRUE;
+}
+
+static void
+immutable_fini(struct bench *b)
+{
+	int i;
+
+	for (i = 0; i < b->layout.nplanes; i++)
+		tex_pool_put(b->textures[i]);
+}
+
+/* glTexImage2D every frame: the driver may reallocate storage each time. */
+static gboolean
+realloc_init(struct bench *b)
+{
+	int i;
+
+	glGenTextures(b->layout.nplanes, b->textures);
+	for (i = 0; i < b->layout.nplanes; i++) {
+		glBindTexture(GL_TEXTURE_2D, b->textures[i]);
+		set_sampling();
+	}
+	return TRUE;
+}
+
+static void
+realloc_upload(struct bench *b, const uint8_t *frame, unsigned int n)
+{
+	int i;
+
+	(void)n;
+	for (i = 0; i < b->layout.nplanes; i++) {
+		const struct tex_plane *p = &b->layout.planes[i];
+
+		glBindTexture(GL_TEXTURE_2D, b->textures[i]);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, p->pitch / p->bpp);
+		glTexImage2D(GL_TEXTURE_2D, 0, p->internal_format, p->width, p->height, 0,
+			     p->format, p->type, frame + p->offset);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	bind_planes(b, b->textures);
+}
+
+static void
+realloc_fini(struct bench *b)
+{
+	glDeleteTextures(b->layout.nplanes, b->textures);
+}
+
+static void
+subimage_upload(struct bench *b, const uint8_t *frame, unsigned int n)
+{
+	(void)n;
+	glActiveTexture(GL_TEXTURE0);
+	sub_image(b, b->textures, frame);
+	bind_planes(b, b->textures);
+}
+
+/* Classic ring of PBOs, mapped and unmapped once per frame. */
+static gboolean
+pbo_init(struct bench *b)
+{
+	int i;
+
+	immutable_init(b);
+	glGenBuffers(BENCH_RING, b->pbos);
+	for (i = 0; i < BENCH_RING; i++) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b->pbos[i]);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, b->layout.frame_size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return TRUE;
+}
+
+static void
+pbo_upload(struct bench *b, const uint8_t *frame, unsigned int n)
+{
+	void *map;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b->pbos[n % BENCH_RING]);
+	map = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, b->layout.frame_size,
+			       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	memcpy(map, frame, b->layout.frame_size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	glActiveTexture(GL_TEXTURE0);
+	sub_image(b, b->textures, NULL);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	bind_planes(b, b->textures);
+}
+
+static void
+pbo_fini(struct bench *b)
+{
+	glDeleteBuffers(BENCH_RING, b->pbos);
+	immutable_fini(b);
+}
+
+static gboolean
+persistent_init(struct bench *b)
+{
+	if (!staging_init(&b->staging, BENCH_RING * b->layout.frame_size))
+		return FALSE;
+	return immutable_init(b);
+}
+
+static void
+persistent_upload(struct bench *b, const uint8_t *frame, unsigned int n)
+{
+	ptrdiff_t offset = staging_alloc(&b->staging, b->layout.frame_size);
+
+	(void)n;
+	memcpy(b->staging.map + offset, frame, b->layout.frame_size);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b->staging.buffer);
+	sub_image(b, b->textures, (const uint8_t *)(uintptr_t)offset);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	staging_fence(&b->staging);
+	bind_planes(b, b->textures);
+}
+
+static void
+persistent_fini(struct bench *b)
+{
+	staging_fini(&b->staging);
+	immutable_fini(b);
+}
+
+/*
+ * Import a ring of udmabufs as EGLImages, one R8/GR88/ABGR8888 image per
+ * plane. Writing the frame into the buffer is the whole upload; the GPU
+ * samples the pages in place, so a buffer is only written again once the
+ * draw of the frame before in it is done.
+ */
+static PFNEGLCREATEIMAGEKHRPROC create_image;
+static PFNEGLDESTROYIMAGEKHRPROC destroy_image;
+static PFNGLEGLIMAGETARGETTEXTURE2DOESPROC image_target_texture;
+
+static void
+eglimage_fini(struct bench *b)
+{
+	int i, j;
+
+	for (i = 0; i < BENCH_RING; i++) {
+		struct dma_frame *d = &b->dma[i];
+
+		if (d->fence) {
+			glClientWaitSync(d->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			glDeleteSync(d->fence);
+		}
+		for (j = 0; j < TEX_MAX_PLANES; j++)
+			if (d->images[j])
+				destroy_image(ctx.display, d->images[j]);
+		if (d->textures[0])
+			glDeleteTextures(b->layout.nplanes, d->textures);
+		if (d->map)
+			munmap(d->map, d->size);
+		if (d->dmabuf > 0)
+			close(d->dmabuf);
+		if (d->memfd > 0)
+			close(d->memfd);
+	}
+	memset(b->dma, 0, sizeof(b->dma));
+}
+
+static gboolean
+eglimage_init(struct bench *b)
+{
+#ifdef HAVE_UDMABUF
+	long page = sysconf(_SC_PAGESIZE);
+	int dev, i, j;
+
+	if (!render_ctx_has_egl_ext(&ctx, "EGL_EXT_image_dma_buf_import") ||
+	    !has_extension((const char *)glGetString(GL_EXTENSIONS), "GL_OES_EGL_image"))
+		return FALSE;
+	create_image = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
+	destroy_image = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
+	image_target_texture = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)
+		eglGetProcAddress("glEGLImageTargetTexture2DOES");
+	dev = open("/dev/udmabuf", O_RDWR);
+	if (dev < 0)
+		return FALSE;
+
+	for (i = 0; i < BENCH_RING; i++) {
+		struct dma_frame *d = &b->dma[i];
+		struct udmabuf_create create = { 0 };
+
+		d->size = (b->layout.frame_size + page - 1) / page * page;
+		d->memfd = memfd_create("uploadbench", MFD_ALLOW_SEALING);
+		if (d->memfd < 0 || ftruncate(d->memfd, d->size) < 0 ||
+		    fcntl(d->memfd, F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+			goto fail;
+		create.memfd = d->memfd;
+		create.size = d->size;
+		d->dmabuf = ioctl(dev, UDMABUF_CREATE, &create);
+		if (d->dmabuf < 0)
+			goto fail;
+		d->map = mmap(NULL, d->size, PROT_READ | PROT_WRITE, MAP_SHARED, d->memfd, 0);
+		if (d->map == MAP_FAILED) {
+			d->map = NULL;
+			goto fail;
+		}
+
+		glGenTextures(b->layout.nplanes, d->textures);
+		for (j = 0; j < b->layout.nplanes; j++) {
+			const struct tex_plane *p = &b->layout.planes[j];
+			EGLint attribs[] = {
+				EGL_WIDTH, p->width,
+				EGL_HEIGHT, p->height,
+				EGL_LINUX_DRM_FOURCC_EXT,
+				p->bpp == 4 ? fourcc('A', 'B', '2', '4') :
+				p->bpp == 1 ? fourcc('R', '8', ' ', ' ') : fourcc('G', 'R', '8', '8'),
+				EGL_DMA_BUF_PLANE0_FD_EXT, d->dmabuf,
+				EGL_DMA_BUF_PLANE0_OFFSET_EXT, (EGLint)p->offset,
+				EGL_DMA_BUF_PLANE0_PITCH_EXT, p->pitch,
+				EGL_NONE
+			};
+
+			d->images[j] = create_image(ctx.display, EGL_NO_CONTEXT,
+						    EGL_LINUX_DMA_BUF_EXT, NULL, attribs);
+			if (!d->images[j])
+				goto fail;
+			glBindTexture(GL_TEXTURE_2D, d->textures[j]);
+			image_target_texture(GL_TEXTURE_2D, d->images[j]);
+			set_sampling();
+		}
+	}
+	close(dev);
+	return glGetError() == GL_NO_ERROR;
+
+fail:
+	close(dev);
+	eglimage_fini(b);
+#else
+	(void)b;
+#endif
+	return FALSE;
+}
+
+static void
+eglimage_upload(struct bench *b, const uint8_t *frame, unsigned int n)
+{
+	struct dma_frame *d = &b->dma[n % BENCH_RING];
+
+	/* The draw of the previous frame is issued by now. */
+	if (n > 0)
+		b->dma[(n - 1) % BENCH_RING].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (d->fence) {
+		glClientWaitSync(d->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		glDeleteSync(d->fence);
+		d->fence = NULL;
+	}
+	memcpy(d->map, frame, b->layout.frame_size);
+	bind_planes(b, d->textures);
+}
+
+static const struct strategy all_strategies[] = {
+	{ "realloc", realloc_init, realloc_upload, realloc_fini },
+	{ "subimage", immutable_init, subimage_upload, immutable_fini },
+	{ "pbo", pbo_init, pbo_upload, pbo_fini },
+	{ "persistent", persistent_init, persistent_upload, persistent_fini },
+	{ "eglimage", eglimage_init, eglimage_upload, eglimage_fini },
+};
+
+struct result {
+	double mb_s;
+	double cpu_ms;		/* CPU time of the submitting thread, per frame */
+	double latency_ms;	/* upload start to GPU done, polled */
+	double latency_max_ms;
+};
+
+static void
+run(const struct strategy *st, struct bench *b, const uint8_t *const *set, struct result *r)
+{
+	struct {
+		GLsync fence;
+		gint64 start;
+	} flight[BENCH_RING + 1];
+	int head = 0, count = 0, n;
+	int frames = bench_frames(), measured = 0;
+	double cpu = 0, latency = 0;
+	gint64 start = 0;
+	size_t bytes = 0;
+	int i;
+
+	for (i = 0; i < b->layout.nplanes; i++)
+		bytes += (size_t)b->layout.planes[i].width * b->layout.planes[i].height *
+			b->layout.planes[i].bpp;
+
+	memset(r, 0, sizeof(*r));
+	for (n = 0; n < BENCH_WARMUP + frames; n++) {
+		gboolean timed = n >= BENCH_WARMUP;
+		gint64 t0;
+		double c0;
+
+		if (n == BENCH_WARMUP) {
+			glFinish();
+			start = g_get_monotonic_time();
+		}
+
+		t0 = g_get_monotonic_time();
+		c0 = thread_cpu_ms();
+		st->upload(b, set[n % BENCH_FRAMES], n);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		flight[(head + count) % (BENCH_RING + 1)].fence =
+			glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		flight[(head + count) % (BENCH_RING + 1)].start = timed ? t0 : 0;
+		count++;
+		glFlush();
+		if (timed)
+			cpu += thread_cpu_ms() - c0;
+
+		/* Retire whatever is done; block only when the ring is full. */
+		while (count) {
+			GLenum status = glClientWaitSync(flight[head].fence, 0,
+							 count > BENCH_RING ? 1000000000 : 0);
+			double ms;
+
+			if (status == GL_TIMEOUT_EXPIRED && count <= BENCH_RING)
+				break;
+			if (flight[head].start) {
+				ms = (g_get_monotonic_time() - flight[head].start) / 1000.0;
+				latency += ms;
+				r->latency_max_ms = MAX(r->latency_max_ms, ms);
+				measured++;
+			}
+			glDeleteSync(flight[head].fence);
+			head = (head + 1) % (BENCH_RING + 1);
+			count--;
+		}
+	}
+	while (count) {
+		double ms;
+
+		glClientWaitSync(flight[head].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		if (flight[head].start) {
+			ms = (g_get_monotonic_time() - flight[head].start) / 1000.0;
+			latency += ms;
+			r->latency_max_ms = MAX(r->latency_max_ms, ms);
+			measured++;
+		}
+		glDeleteSync(flight[head].fence);
+		head = (head + 1) % (BENCH_RING + 1);
+		count--;
+	}
+
+	r->mb_s = (double)bytes * frames / (g_get_monotonic_time() - start);
+	r->cpu_ms = cpu / frames;
+	r->latency_ms = latency / measured;
+}
+
+/* r is NULL when the strategy is unsupported. */
+static void
+print_row(const char *strategy, const char *format, int width, int height,
+	  const struct result *r)
+{
+	static const char *const columns[] = {
+		"frames", "mb_s", "cpu_ms", "latency_ms", "latency_max_ms",
+	};
+	unsigned int i;
+
+	bench_row_begin();
+	bench_field_str("strategy", strategy);
+	bench_field_str("format", format);
+	bench_field("width", "%d", width);
+	bench_field("height", "%d", height);
+	if (r) {
+		bench_field("frames", "%d", bench_frames());
+		bench_field("mb_s", "%.1f", r->mb_s);
+		bench_field("cpu_ms", "%.3f", r->cpu_ms);
+		bench_field("latency_ms", "%.3f", r->latency_ms);
+		bench_field("latency_max_ms", "%.3f", r->latency_max_ms);
+	} else {
+		for (i = 0; i < G_N_ELEMENTS(columns); i++)
+			bench_field_none(columns[i]);
+	}
+	bench_field_str("status", r ? "ok" : "unsupported");
+	bench_row_end();
+}
+
+int
+main(int argc, char **argv)
+{
+	gchar **size_list, **format_list;
+	int s, f, i;
+	unsigned int k;
+
+	if (!bench_parse_args(&argc, &argv, entries, 120))
+		return 1;
+
+	if (!render_ctx_init_offscreen(&ctx, RENDER_API_GLES))
+		return 1;
+
+	/* Draws go to a small FBO; the point is to make the GPU read the planes. */
+	program = program_get(fullscreen_vert_shader(GL_FALSE), frag_shader_text, NULL);
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "uTex0"), 0);
+	glUniform1i(glGetUniformLocation(program, "uTex1"), 1);
+	bench_target_get(16, 16);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	size_list = g_strsplit(sizes, ",", -1);
+	format_list = g_strsplit(formats, ",", -1);
+	for (s = 0; size_list[s]; s++) {
+		int width, height;
+
+		if (sscanf(size_list[s], "%dx%d", &width, &height) != 2) {
+			fprintf(stderr, "Error: bad size '%s'\n", size_list[s]);
+			return 1;
+		}
+
+		for (f = 0; format_list[f]; f++) {
+			const char *format = format_list[f];
+			struct frame_source *source;
+			const uint8_t *set[BENCH_FRAMES];
+			enum tex_format fmt;
+			struct bench b;
+
+			memset(&b, 0, sizeof(b));
+			if (!tex_format_from_name(format, &fmt) ||
+			    !tex_stream_init(&b.layout, fmt, width, height, NULL, NULL, 64))
+				return 1;
+
+			/* Noise: every byte changes, so no path gets away with less. */
+			source = frame_source_new("noise", &b.layout, NULL, NULL);
+			for (i = 0; i < BENCH_FRAMES; i++)
+				set[i] = frame_source_get(source, i);
+
+			for (k = 0; k < G_N_ELEMENTS(all_strategies); k++) {
+				const struct strategy *st = &all_strategies[k];
+				struct result r;
+
+				if (!bench_in_list(strategies, st->name))
+					continue;
+				if (!st->init(&b)) {
+					print_row(st->name, format, width, height, NULL);
+					continue;
+				}
+				run(st, &b, set, &r);
+				st->fini(&b);
+				glCheckError();
+				print_row(st->name, format, width, height, &r);
+			}
+
+			for (i = 0; i < BENCH_FRAMES; i++)
+				frame_source_release(source, set[i]);
+			frame_source_destroy(source);
+			tex_stream_fini(&b.layout);
+		}
+	}
+	bench_finish();
+
+	g_strfreev(size_list);
+	g_strfreev(format_list);
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include <string.h>
+
+#include <glib.h>
+
+#include "vecmath.h"
+
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int v4si __attribute__((vector_size(16)));
+typedef unsigned int v4su __attribute__((vector_size(16)));
+
+/* pi / 2 in three parts, the first two exact in few bits (Cody and Waite). */
+#define PIO2_1 1.5703125f
+#define PIO2_2 4.837512969970703125e-4f
+#define PIO2_3 7.54978995489188216e-8f
+#define TWO_OVER_PI 0.636619772367581343f
+
+/* Minimax polynomials on [-pi/4, pi/4], from Cephes. */
+#define SIN_1 -1.9515295891e-4f
+#define SIN_2 8.3321608736e-3f
+#define SIN_3 -1.6666654611e-1f
+#define COS_1 2.443315711809948e-5f
+#define COS_2 -1.388731625493765e-3f
+#define COS_3 4.166664568298827e-2f
+
+static inline v4sf
+load4(const float *p)
+{
+	v4sf v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void
+store4(float *p, v4sf v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline v4sf
+select4(v4si mask, v4sf a, v4sf b)
+{
+	return (v4sf)((mask & (v4si)a) | (~mask & (v4si)b));
+}
+
+/*
+ * Four sines and cosines: reduce to r in [-pi/4, pi/4] and quadrant q,
+ * evaluate both polynomials, then swap and negate by quadrant.
+ */
+static inline void
+sincos4(v4sf a, v4sf *s, v4sf *c)
+{
+	v4sf y = a * TWO_OVER_PI + 0.5f;
+	v4si q = __builtin_convertvector(y, v4si);
+	v4sf qf, r, z, ps, pc;
+
+	/* Truncation rounds towards 0, make it floor. */
+	q += (v4si)(__builtin_convertvector(q, v4sf) > y);
+	qf = __builtin_convertvector(q, v4sf);
+	r = ((a - qf * PIO2_1) - qf * PIO2_2) - qf * PIO2_3;
+
+	z = r * r;
+	ps = ((SIN_1 * z + SIN_2) * z + SIN_3) * z * r + r;
+	pc = ((COS_1 * z + COS_2) * z + COS_3) * z * z - 0.5f * z + 1.0f;
+
+	*s = select4((q & 1) != 0, pc, ps);
+	*c = select4((q & 1) != 0, ps, pc);
+	*s = (v4sf)((v4su)*s ^ ((v4su)(q & 2) << 30));
+	*c = (v4sf)((v4su)*c ^ ((v4su)((q + 1) & 2) << 30));
+}
+
+void
+vm_sincos(float a, float *s, float *c)
+{
+	v4sf vs, vc;
+
+	sincos4((v4sf){ a, a, a, a }, &vs, &vc);
+	*s = vs[0];
+	*c = vc[0];
+}
+
+void
+mat4_multiply(float *r, const float *a, const float *b)
+{
+	v4sf a0 = load4(a), a1 = load4(a + 4), a2 = load4(a + 8), a3 = load4(a + 12);
+	v4sf col[4];
+	int i;
+
+	for (i = 0; i < 4; i++)
+		col[i] = a0 * b[i * 4] + a1 * b[i * 4 + 1] + a2 * b[i * 4 + 2] + a3 * b[i * 4 + 3];
+	for (i = 0; i < 4; i++)
+		store4(r + i * 4, col[i]);
+}
+
+void
+mat4_rotation_y(float *m, float angle)
+{
+	float s, c;
+
+	vm_sincos(angle, &s, &c);
+	memset(m, 0, 16 * sizeof(float));
+	m[0] = c;
+	m[2] = s;
+	m[5] = 1;
+	m[8] = -s;
+	m[10] = c;
+	m[15] = 1;
+}
+
+/*
+ * Four instances from i on, scale folded into the sine and cosine; the
+ * lanes past count repeat the last instance and are not stored.
+ */
+static inline void
+load_instances(const struct vm_instance *inst, int i, int count, float angle,
+	       v4sf *x, v4sf *y, v4sf *scale, v4sf *s, v4sf *c)
+{
+	const struct vm_instance *p[4];
+	v4sf phase;
+	int k;
+
+	for (k = 0; k < 4; k++)
+		p[k] = &inst[MIN(i + k, count - 1)];
+	*x = (v4sf){ p[0]->x, p[1]->x, p[2]->x, p[3]->x };
+	*y = (v4sf){ p[0]->y, p[1]->y, p[2]->y, p[3]->y };
+	*scale = (v4sf){ p[0]->scale, p[1]->scale, p[2]->scale, p[3]->scale };
+	phase = (v4sf){ p[0]->phase, p[1]->phase, p[2]->phase, p[3]->phase };
+
+	sincos4(phase + angle, s, c);
+	*s *= *scale;
+	*c *= *scale;
+}
+
+void
+vm_model_matrices(const struct vm_instance *inst, int count, float angle, float *matrices)
+{
+	v4sf x, y, scale, s, c;
+	int i, k;
+
+	for (i = 0; i < count; i += 4) {
+		load_instances(inst, i, count, angle, &x, &y, &scale, &s, &c);
+		for (k = 0; k < 4 && i + k < count; k++) {
+			float *m = &matrices[(i + k) * 16];
+
+			store4(m, (v4sf){ c[k], 0, s[k], 0 });
+			store4(m + 4, (v4sf){ 0, scale[k], 0, 0 });
+			store4(m + 8, (v4sf){ -s[k], 0, c[k], 0 });
+			store4(m + 12, (v4sf){ x[k], y[k], 0, 1 });
+		}
+	}
+}
+
+void
+vm_model_vertices(const struct vm_instance *inst, int count, float angle,
+		  const float *points, int npoints, float *out)
+{
+	v4sf x, y, scale, s, c;
+	int i, k, v;
+
+	for (i = 0; i < count; i += 4) {
+		load_instances(inst, i, count, angle, &x, &y, &scale, &s, &c);
+		for (v = 0; v < npoints; v++) {
+			v4sf px = c * points[v * 2] + x;
+			v4sf py = scale * points[v * 2 + 1] + y;
+			v4sf pz = s * points[v * 2];
+
+			for (k = 0; k < 4 && i + k < count; k++) {
+				float *o = &out[((i + k) * npoints + v) * 3];
+
+				o[0] = px[k];
+				o[1] = py[k];
+				o[2] = pz[k];
+			}
+		}
+	}
+}
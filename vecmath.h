@@ -0,0 +1,39 @@
+#ifndef VECMATH_H
+#define VECMATH_H
+
+/*
+ * CPU side matrix math for many instances at once. Matrices are 16
+ * floats, column major, as glUniformMatrix4fv and mat4 attributes take
+ * them; no alignment is needed. The batch functions work four lanes at
+ * a time with GCC vector extensions, which become SSE on x86 and NEON
+ * on ARM, and take sine and cosine from a polynomial good to about
+ * 1e-7 (1 ulp or so) for angles within a few thousand radians.
+ */
+
+/* Placement of an instance: centre, uniform scale, turn about y in radians. */
+struct vm_instance {
+	float x, y, scale, phase;
+};
+
+void vm_sincos(float a, float *s, float *c);
+
+/* r = a * b; r may be a or b. */
+void mat4_multiply(float *r, const float *a, const float *b);
+/* Rotation by angle radians about the y axis. */
+void mat4_rotation_y(float *m, float angle);
+
+/*
+ * Model matrix of each instance, turned by angle plus its phase, scaled
+ * and moved to its centre: 16 floats per instance into matrices.
+ */
+void vm_model_matrices(const struct vm_instance *inst, int count, float angle,
+		       float *matrices);
+
+/*
+ * The same transform applied to npoints 2D points (x, y pairs) per
+ * instance: x, y, z per point per instance into out.
+ */
+void vm_model_vertices(const struct vm_instance *inst, int count, float angle,
+		       const float *points, int npoints, float *out);
+
+#endif
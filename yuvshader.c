@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "glstate.h"
+#include "program.h"
+#include "yuvshader.h"
+
+#define FRAG_HEADER \
+	"#version 300 es				\n" \
+	"precision mediump float;			\n" \
+	"						\n" \
+	"in vec2 vTexCoord;				\n" \
+	"						\n" \
+	"uniform sampler2D uTex0;			\n" \
+	"uniform sampler2D uTex1;			\n" \
+	"uniform sampler2D uTex2;			\n" \
+	"						\n" \
+	"out vec4 fragColor;				\n" \
+	"						\n"
+
+/* yuv() returns the normalised Y, Cb and Cr at a texture coordinate. */
+#define SEMI_PLANAR(UV) \
+	"vec3 yuv(vec2 t) {				\n" \
+	"  return vec3(texture(uTex0, t).x, texture(uTex1, t)." UV ");\n" \
+	"}						\n"
+
+#define PLANAR(U, V) \
+	"vec3 yuv(vec2 t) {				\n" \
+	"  return vec3(texture(uTex0, t).x, texture(" U ", t).x, texture(" V ", t).x);\n" \
+	"}						\n"
+
+/*
+ * Packed 4:2:2 is one RGBA8 texel per pixel pair. The filtered fetch is
+ * right for chroma, one sample per texel; luma is two, so it is filtered
+ * by hand from four unfiltered fetches.
+ */
+#define PACKED(Y0, Y1, UV) \
+	"precision highp float;				\n" \
+	"						\n" \
+	"float luma(ivec2 p, ivec2 size) {		\n" \
+	"  p = clamp(p, ivec2(0), ivec2(size.x * 2 - 1, size.y - 1));\n" \
+	"  vec4 t = texelFetch(uTex0, ivec2(p.x >> 1, p.y), 0);\n" \
+	"  return (p.x & 1) == 0 ? t." Y0 " : t." Y1 ";\n" \
+	"}						\n" \
+	"						\n" \
+	"vec3 yuv(vec2 t) {				\n" \
+	"  ivec2 size = textureSize(uTex0, 0);		\n" \
+	"  vec2 p = t * vec2(size.x * 2, size.y) - 0.5;	\n" \
+	"  ivec2 i = ivec2(floor(p));			\n" \
+	"  vec2 f = p - floor(p);			\n" \
+	"  float y = mix(mix(luma(i, size), luma(i + ivec2(1, 0), size), f.x),\n" \
+	"                mix(luma(i + ivec2(0, 1), size), luma(i + ivec2(1, 1), size), f.x), f.y);\n" \
+	"  return vec3(y, texture(uTex0, t)." UV ");	\n" \
+	"}						\n"
+
+/*
+ * 16 bit samples arrive as low and high byte channels. Filtering is
+ * linear, so putting them back together after it is still exact; the
+ * 10 bits sit at the top.
+ */
+#define P010_BYTES \
+	"precision highp float;				\n" \
+	"						\n" \
+	"const vec2 w16 = vec2(255.0, 65280.0) / 65472.0;\n" \
+	"						\n" \
+	"vec3 yuv(vec2 t) {				\n" \
+	"  vec4 c = texture(uTex1, t);			\n" \
+	"  return vec3(dot(texture(uTex0, t).xy, w16), dot(c.xy, w16), dot(c.zw, w16));\n" \
+	"}						\n"
+
+/*
+ * With 16 bit unorm textures only the scale from 16 to 10 bits is left,
+ * 65535 / 65472 written so no literal overflows half float.
+ */
+#define P010_NORM16 \
+	"precision highp float;				\n" \
+	"						\n" \
+	"vec3 yuv(vec2 t) {				\n" \
+	"  return vec3(texture(uTex0, t).x, texture(uTex1, t).xy) * (1023.984375 / 1023.0);\n" \
+	"}						\n"
+
+static const char *const samplers[] = {
+	[TEX_FORMAT_RGBA] = NULL,
+	[TEX_FORMAT_NV12] = SEMI_PLANAR("xy"),
+	[TEX_FORMAT_NV21] = SEMI_PLANAR("yx"),
+	[TEX_FORMAT_I420] = PLANAR("uTex1", "uTex2"),
+	[TEX_FORMAT_YV12] = PLANAR("uTex2", "uTex1"),
+	[TEX_FORMAT_YUYV] = PACKED("x", "z", "yw"),
+	[TEX_FORMAT_UYVY] = PACKED("y", "w", "xz"),
+	[TEX_FORMAT_P010] = P010_BYTES,
+};
+
+#define SDR_MAIN \
+	"void main() {					\n" \
+	"  vec3 c = yuv(vTexCoord);			\n" \
+	"  float y = c.x;				\n" \
+	"  vec2 uv = c.yz - 0.5;			\n" \
+	"  fragColor = vec4(y + 1.13983*uv.y,		\n" \
+	"                   y - 0.39465*uv.x - 0.58060*uv.y,\n" \
+	"                   y + 2.03211*uv.x, 1.0);	\n" \
+	"}						\n"
+
+/*
+ * Linear light comes out relative to SDR white. Tone mapping is
+ * extended Reinhard on luminance, so hue and saturation stay put and
+ * the content peak lands exactly on white.
+ */
+#define HDR_CONSTANTS \
+	"precision highp float;				\n" \
+	"						\n" \
+	"uniform float uRefWhite;			\n" \
+	"uniform float uPeak;				\n" \
+	"						\n" \
+	"const vec3 bt2020_luma = vec3(0.2627, 0.6780, 0.0593);\n" \
+	"const mat3 bt2020_to_bt709 = mat3(		\n" \
+	"   1.6605, -0.1246, -0.0182,			\n" \
+	"  -0.5876,  1.1329, -0.1006,			\n" \
+	"  -0.0728, -0.0083,  1.1187);			\n" \
+	"						\n" \
+	"vec3 bt2020_rgb(vec3 c) {			\n" \
+	"  float y = (c.x - 64.0 / 1023.0) * (1023.0 / 876.0);\n" \
+	"  vec2 uv = (c.yz - 512.0 / 1023.0) * (1023.0 / 896.0);\n" \
+	"  return vec3(y + 1.4746*uv.y,			\n" \
+	"              y - 0.16455*uv.x - 0.57135*uv.y,	\n" \
+	"              y + 1.8814*uv.x);			\n" \
+	"}						\n" \
+	"						\n" \
+	"vec3 tonemap(vec3 rgb) {			\n" \
+	"  float l = dot(rgb, bt2020_luma);		\n" \
+	"  float m = l * (1.0 + l / (uPeak * uPeak)) / (1.0 + l);\n" \
+	"  return l > 0.0 ? rgb * (m / l) : vec3(0.0);	\n" \
+	"}						\n" \
+	"						\n" \
+	"vec3 srgb(vec3 v) {				\n" \
+	"  return mix(v * 12.92, 1.055 * pow(v, vec3(1.0 / 2.4)) - 0.055,\n" \
+	"             step(0.0031308, v));		\n" \
+	"}						\n"
+
+#define HDR_MAIN \
+	"void main() {					\n" \
+	"  vec3 rgb = clamp(bt2020_rgb(yuv(vTexCoord)), 0.0, 1.0);\n" \
+	"  rgb = clamp(bt2020_to_bt709 * tonemap(eotf(rgb)), 0.0, 1.0);\n" \
+	"  fragColor = vec4(srgb(rgb), 1.0);		\n" \
+	"}						\n"
+
+#define PQ_EOTF \
+	"vec3 eotf(vec3 e) {				\n" \
+	"  vec3 p = pow(e, vec3(1.0 / 78.84375));	\n" \
+	"  vec3 l = pow(max(p - 0.8359375, 0.0) / (18.8515625 - 18.6875 * p),\n" \
+	"               vec3(1.0 / 0.1593017578125));	\n" \
+	"  return l * (10000.0 / uRefWhite);		\n" \
+	"}						\n"
+
+/* Inverse OETF, then the OOTF of a 1000 nit display (system gamma 1.2). */
+#define HLG_EOTF \
+	"vec3 eotf(vec3 e) {				\n" \
+	"  vec3 lo = e * e / 3.0;			\n" \
+	"  vec3 hi = (exp((e - 0.55991073) / 0.17883277) + 0.28466892) / 12.0;\n" \
+	"  vec3 s = mix(lo, hi, step(0.5, e));		\n" \
+	"  float ys = max(dot(s, bt2020_luma), 1e-6);	\n" \
+	"  return s * pow(ys, 0.2) * (1000.0 / uRefWhite);\n" \
+	"}						\n"
+
+static const char *const transfer_names[] = {
+	[YUV_TRANSFER_SDR] = "sdr",
+	[YUV_TRANSFER_PQ] = "pq",
+	[YUV_TRANSFER_HLG] = "hlg",
+};
+
+static const char *const eotfs[] = {
+	[YUV_TRANSFER_SDR] = NULL,
+	[YUV_TRANSFER_PQ] = PQ_EOTF,
+	[YUV_TRANSFER_HLG] = HLG_EOTF,
+};
+
+gboolean
+yuv_transfer_from_name(const char *name, enum yuv_transfer *transfer)
+{
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(transfer_names); i++) {
+		if (!strcmp(name, transfer_names[i])) {
+			*transfer = i;
+			return TRUE;
+		}
+	}
+	fprintf(stderr, "Error: unknown transfer '%s', try sdr, pq or hlg\n", name);
+	return FALSE;
+}
+
+const char *
+yuv_transfer_name(enum yuv_transfer transfer)
+{
+	return transfer_names[transfer];
+}
+
+const char *
+yuv_frag_shader(const struct tex_stream *s, enum yuv_transfer transfer)
+{
+	static char *built[G_N_ELEMENTS(samplers)][2][G_N_ELEMENTS(transfer_names)];
+	gboolean norm16 = s->planes[0].type == GL_UNSIGNED_SHORT;
+	char **text = &built[s->format][norm16][transfer];
+
+	if (!samplers[s->format])
+		return NULL;
+	if (!*text) {
+		const char *sampler = norm16 ? P010_NORM16 : samplers[s->format];
+
+		/* eotf() needs the HDR constants, main() needs eotf(). */
+		if (transfer == YUV_TRANSFER_SDR)
+			*text = g_strconcat(FRAG_HEADER, sampler, SDR_MAIN, NULL);
+		else
+			*text = g_strconcat(FRAG_HEADER, sampler, HDR_CONSTANTS, eotfs[transfer],
+					    HDR_MAIN, NULL);
+	}
+
+	return *text;
+}
+
+void
+yuv_program_init(GLuint program, float peak_nits)
+{
+	gl_state_use_program(program);
+	gl_state_uniform1i(glGetUniformLocation(program, "uTex0"), 0);
+	gl_state_uniform1i(glGetUniformLocation(program, "uTex1"), 1);
+	gl_state_uniform1i(glGetUniformLocation(program, "uTex2"), 2);
+	gl_state_uniform1f(glGetUniformLocation(program, "uRefWhite"), YUV_REF_WHITE);
+	gl_state_uniform1f(glGetUniformLocation(program, "uPeak"), peak_nits / YUV_REF_WHITE);
+	glCheckError();
+}
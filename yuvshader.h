@@ -0,0 +1,38 @@
+#ifndef YUVSHADER_H
+#define YUVSHADER_H
+
+#include <glib.h>
+#include <GLES3/gl3.h>
+
+#include "texstream.h"
+
+/* How the decoded R'G'B' relates to light. */
+enum yuv_transfer {
+	YUV_TRANSFER_SDR,	/* full range, shown as is */
+	YUV_TRANSFER_PQ,	/* BT.2020 limited range, SMPTE ST 2084 */
+	YUV_TRANSFER_HLG,	/* BT.2020 limited range, ARIB STD-B67 */
+};
+
+/* Nits SDR white maps to, BT.2408 reference white. */
+#define YUV_REF_WHITE 203.0f
+
+gboolean yuv_transfer_from_name(const char *name, enum yuv_transfer *transfer);
+const char *yuv_transfer_name(enum yuv_transfer transfer);
+
+/*
+ * Fragment shader turning the planes of s, as uploaded (plane i on unit
+ * i, uniform uTexi), into display RGB: sampling, the YCbCr matrix and
+ * for HDR the EOTF, tone mapping to SDR, the BT.2020 to BT.709 gamut
+ * conversion and the sRGB curve, all in one pass. Takes vTexCoord and
+ * writes fragColor. Built once per combination and kept, so the pointer
+ * can go to program_get().
+ */
+const char *yuv_frag_shader(const struct tex_stream *s, enum yuv_transfer transfer);
+
+/*
+ * Point the samplers of a linked yuv_frag_shader() program at units 0
+ * to 2 and set the HDR content peak, in nits. Leaves it in use.
+ */
+void yuv_program_init(GLuint program, float peak_nits);
+
+#endif